@@ -1,6 +1,6 @@
 #!/bin/bash
 
-C_FUNCTIONS_LIST='["_Board_create", "_Board_print", "_Board_destroy", "_Board_maxify", "_Board_init_problem", "_Board_reduce", "_Board_create_from_full_array", "_Board_get_full_tile", "_Board_get_reduced_tile"]'
+C_FUNCTIONS_LIST='["_Board_create", "_Board_create_seeded", "_Board_print", "_Board_destroy", "_Board_maxify", "_Board_init_problem", "_Board_reduce", "_Board_create_from_full_array", "_Board_get_full_tile", "_Board_get_reduced_tile"]'
 
 # -s ASSERTIONS=1                                  \
 # -s WASM=1                                        \
@@ -9,6 +9,7 @@ emcc -O3                                         \
      --memory-init-file 0                        \
      c_board/Board.c                             \
      c_board/simple_solver/Problem.c             \
+     c_board/bitboard_solver/EasySolver.c        \
      -o Board.js
 
 cat Board_api.js Board.js > js/Board.js
@@ -0,0 +1,309 @@
+#include "Batch.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifndef min
+#        define min(x,y) ((x) < (y)?(x):(y))
+#endif
+
+// Tasks are numbered job by job. Thread k starts with tasks k, k + n, k + 2n...
+// (n deques): the j-th of them is k + j * n for top <= j < bottom.
+// The owner takes from the bottom, thieves from the top.
+struct BatchDeque {
+        pthread_mutex_t lock;
+        unsigned        top;
+        unsigned        bottom;
+};
+
+struct BatchWorker {
+        struct Batch          * batch;
+        unsigned                id;
+        pthread_t               thread;
+        struct BatchThreadStats stats;
+};
+
+struct Batch {
+        const struct BatchJob * jobs;
+        unsigned              * task_job;   // Which job each task makes a board for
+        unsigned              * task_index; // Which of that job's boards
+        double                * latency;    // Of each task, in seconds
+        unsigned                n_tasks;
+        unsigned                seed;
+
+        BatchSink               sink;
+        void                  * ctx;
+        pthread_mutex_t         sink_lock;
+        unsigned                n_failed;   // Under sink_lock
+
+        unsigned                n_deques;
+        struct BatchDeque     * deques;
+        struct BatchWorker    * workers;
+};
+
+static double Batch_now(void)
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// splitmix64's finaliser
+static uint64_t Batch_mix(uint64_t x)
+{
+        x += 0x9e3779b97f4a7c15u;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9u;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebu;
+        return x ^ (x >> 31);
+}
+
+static unsigned Batch_board_seed(unsigned seed, unsigned job, unsigned index)
+{
+        return (unsigned)Batch_mix(Batch_mix(Batch_mix(seed) ^ job) ^ index);
+}
+
+// Worker id's next task: the newest of its own, or else the oldest of someone else's
+static CSError Batch_take(struct Batch * batch, unsigned id, unsigned * task, unsigned * stolen)
+{
+        for (unsigned k = 0; k < batch->n_deques; k++) {
+                unsigned victim = (id + k) % batch->n_deques;
+                struct BatchDeque * d = &batch->deques[victim];
+                pthread_mutex_lock(&d->lock);
+                if (d->top < d->bottom) {
+                        unsigned j = (0 == k) ? --d->bottom : d->top++;
+                        pthread_mutex_unlock(&d->lock);
+                        *task = victim + j * batch->n_deques;
+                        *stolen = (0 != k);
+                        return NO_FAILURE;
+                }
+                pthread_mutex_unlock(&d->lock);
+        }
+        return FAILURE;
+}
+
+// Each board draws from its own generator, so nothing here is shared
+static struct Board * Batch_make_board(const struct BatchJob * job, unsigned seed)
+{
+        struct Board * board = Board_create_seeded(job->size, job->size, seed);
+        if (!board) {
+                goto bad_alloc1;
+        }
+        if (NO_FAILURE != Board_maxify(board, min(job->size, 9))) {
+                goto bad_alloc2;
+        }
+        Board_init_problem(board, job->difficulty);
+        if (!board->private) {
+                goto bad_alloc2;
+        }
+        while (Board_reduce(board, job->size) != 1.) {
+        }
+        return board;
+bad_alloc2:
+        Board_destroy(board);
+bad_alloc1:
+        return NULL;
+}
+
+static void * BatchWorker_run(void * arg)
+{
+        struct BatchWorker * w = arg;
+        struct Batch * batch = w->batch;
+        unsigned task;
+        unsigned stolen;
+        while (NO_FAILURE == Batch_take(batch, w->id, &task, &stolen)) {
+                const struct BatchJob * job = &batch->jobs[batch->task_job[task]];
+                unsigned index = batch->task_index[task];
+                unsigned seed = Batch_board_seed(batch->seed, batch->task_job[task], index);
+                double start = Batch_now();
+
+                struct Board * board = Batch_make_board(job, seed);
+                pthread_mutex_lock(&batch->sink_lock);
+                if (!board) {
+                        batch->n_failed++;
+                } else if (batch->sink) {
+                        batch->sink(batch->ctx, job, index, seed, board);
+                }
+                pthread_mutex_unlock(&batch->sink_lock);
+
+                double end = Batch_now();
+                if (board) {
+                        Board_destroy(board);
+                        w->stats.n_boards++;
+                        w->stats.n_stolen += stolen;
+                }
+                w->stats.busy_seconds += end - start;
+                batch->latency[task] = end - start;
+        }
+        return NULL;
+}
+
+static int Batch_compare_doubles(const void * a, const void * b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+// Nearest rank
+static double Batch_percentile(const double * sorted, unsigned n, double q)
+{
+        if (0 == n) {
+                return 0;
+        }
+        unsigned rank = (unsigned)ceil(q * n);
+        return sorted[rank ? rank - 1 : 0];
+}
+
+static CSError Batch_report(struct Batch * batch, unsigned n_threads, double seconds, struct BatchReport * report)
+{
+        struct BatchThreadStats * threads = malloc(n_threads * sizeof(struct BatchThreadStats));
+        if (!threads) { goto bad_alloc1; }
+        double * sorted = malloc((batch->n_tasks + 1) * sizeof(double));
+        if (!sorted) { goto bad_alloc2; }
+
+        *report = (struct BatchReport){
+                .n_threads = n_threads,
+                .n_boards  = 0,
+                .n_failed  = batch->n_failed,
+                .seconds   = seconds,
+                .threads   = threads};
+        for (unsigned k = 0; k < n_threads; k++) {
+                threads[k] = batch->workers[k].stats;
+                report->n_boards += threads[k].n_boards;
+        }
+        memcpy(sorted, batch->latency, batch->n_tasks * sizeof(double));
+        qsort(sorted, batch->n_tasks, sizeof(double), Batch_compare_doubles);
+        report->latency_p50 = Batch_percentile(sorted, batch->n_tasks, 0.50);
+        report->latency_p90 = Batch_percentile(sorted, batch->n_tasks, 0.90);
+        report->latency_p99 = Batch_percentile(sorted, batch->n_tasks, 0.99);
+        report->latency_max = Batch_percentile(sorted, batch->n_tasks, 1.00);
+        free(sorted);
+        return NO_FAILURE;
+bad_alloc2:
+        free(threads);
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+CSError Batch_generate(const struct BatchJob * jobs, unsigned n_jobs, unsigned n_threads, unsigned seed,
+                       BatchSink sink, void * ctx, struct BatchReport * report)
+{
+        n_threads = n_threads ? n_threads : 1;
+        unsigned n_tasks = 0;
+        for (unsigned j = 0; j < n_jobs; j++) {
+                n_tasks += jobs[j].count;
+        }
+        struct Batch batch = {
+                .jobs     = jobs,
+                .n_tasks  = n_tasks,
+                .seed     = seed,
+                .sink     = sink,
+                .ctx      = ctx,
+                .n_failed = 0,
+                .n_deques = n_threads};
+
+        batch.task_job = malloc((n_tasks + 1) * sizeof(unsigned));
+        if (!batch.task_job) { goto bad_alloc1; }
+        batch.task_index = malloc((n_tasks + 1) * sizeof(unsigned));
+        if (!batch.task_index) { goto bad_alloc2; }
+        batch.latency = calloc(n_tasks + 1, sizeof(double));
+        if (!batch.latency) { goto bad_alloc3; }
+        batch.deques = malloc(n_threads * sizeof(struct BatchDeque));
+        if (!batch.deques) { goto bad_alloc4; }
+        batch.workers = calloc(n_threads, sizeof(struct BatchWorker));
+        if (!batch.workers) { goto bad_alloc5; }
+        if (pthread_mutex_init(&batch.sink_lock, NULL)) { goto bad_alloc6; }
+        unsigned n_locks;
+        for (n_locks = 0; n_locks < n_threads; n_locks++) {
+                struct BatchDeque * d = &batch.deques[n_locks];
+                if (pthread_mutex_init(&d->lock, NULL)) { goto bad_alloc7; }
+                d->top = 0;
+                d->bottom = (n_tasks + n_threads - 1 - n_locks) / n_threads;
+        }
+
+        unsigned t = 0;
+        for (unsigned j = 0; j < n_jobs; j++) {
+                for (unsigned k = 0; k < jobs[j].count; k++, t++) {
+                        batch.task_job[t] = j;
+                        batch.task_index[t] = k;
+                }
+        }
+
+        // Worker 0 is the calling thread
+        double start = Batch_now();
+        unsigned n_started = 1;
+        for (unsigned k = 0; k < n_threads; k++) {
+                batch.workers[k].batch = &batch;
+                batch.workers[k].id = k;
+        }
+        for (unsigned k = 1; k < n_threads; k++) {
+                if (pthread_create(&batch.workers[k].thread, NULL, BatchWorker_run, &batch.workers[k])) {
+                        break;
+                }
+                n_started++;
+        }
+        BatchWorker_run(&batch.workers[0]);
+        for (unsigned k = 1; k < n_started; k++) {
+                pthread_join(batch.workers[k].thread, NULL);
+        }
+        double seconds = Batch_now() - start;
+
+        CSError fail = batch.n_failed ? FAIL_ALLOC : NO_FAILURE;
+        if (report && FAIL_ALLOC == Batch_report(&batch, n_started, seconds, report)) {
+                fail = FAIL_ALLOC;
+        }
+        while (n_locks-- > 0) {
+                pthread_mutex_destroy(&batch.deques[n_locks].lock);
+        }
+        pthread_mutex_destroy(&batch.sink_lock);
+        free(batch.workers);
+        free(batch.deques);
+        free(batch.latency);
+        free(batch.task_index);
+        free(batch.task_job);
+        return fail;
+bad_alloc7:
+        while (n_locks-- > 0) {
+                pthread_mutex_destroy(&batch.deques[n_locks].lock);
+        }
+        pthread_mutex_destroy(&batch.sink_lock);
+bad_alloc6:
+        free(batch.workers);
+bad_alloc5:
+        free(batch.deques);
+bad_alloc4:
+        free(batch.latency);
+bad_alloc3:
+        free(batch.task_index);
+bad_alloc2:
+        free(batch.task_job);
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+void BatchReport_print(FILE * f, const struct BatchReport * report)
+{
+        fprintf(f, "%u boards in %.3f s, %.1f boards/s on %u threads",
+                report->n_boards, report->seconds, report->n_boards / report->seconds, report->n_threads);
+        if (report->n_failed) {
+                fprintf(f, ", %u failed", report->n_failed);
+        }
+        fprintf(f, "\nlatency per board: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                1e3 * report->latency_p50, 1e3 * report->latency_p90,
+                1e3 * report->latency_p99, 1e3 * report->latency_max);
+        for (unsigned k = 0; k < report->n_threads; k++) {
+                const struct BatchThreadStats * s = &report->threads[k];
+                fprintf(f, "thread %u: %u boards (%u stolen), %.1f boards/s, %.0f%% busy\n",
+                        k, s->n_boards, s->n_stolen, s->n_boards / report->seconds,
+                        100 * s->busy_seconds / report->seconds);
+        }
+}
+
+void BatchReport_destroy(struct BatchReport * report)
+{
+        free(report->threads);
+        report->threads = NULL;
+}
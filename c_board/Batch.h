@@ -0,0 +1,54 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <stdio.h>
+
+#include "Board.h"
+#include "simple_solver/CSError.h"
+
+////////
+// Batch generation
+////////
+// Native only: generates many boards at once on a work-stealing pool of threads.
+// Each board gets a seed made from the batch seed, its job and its index
+// within the job, so the same batch seed gives the same boards whatever
+// thread ends up making them.
+
+struct BatchJob {
+        unsigned size;       /**< Boards are size x size. */
+        int      difficulty;
+        unsigned count;
+};
+
+// Gets each finished board, and the seed it was made from: Board_create_seeded()
+// with that seed, then Board_maxify() up to min(size, 9), makes it again.
+// Calls are serialised but come in no particular order. The board is
+// destroyed once it returns.
+typedef void (*BatchSink)(void * ctx, const struct BatchJob * job, unsigned index,
+                          unsigned seed, struct Board * board);
+
+struct BatchThreadStats {
+        unsigned n_boards;
+        unsigned n_stolen;     /**< Of those, how many were taken from another thread. */
+        double   busy_seconds; /**< Spent making boards. */
+};
+
+struct BatchReport {
+        unsigned   n_threads;  /**< Threads that ran, the calling one included. */
+        unsigned   n_boards;
+        unsigned   n_failed;   /**< Boards that could not be allocated. */
+        double     seconds;    /**< Wall time of the whole batch. */
+        double     latency_p50; /**< Seconds per board, from start to sink. */
+        double     latency_p90;
+        double     latency_p99;
+        double     latency_max;
+        struct BatchThreadStats * threads;
+};
+
+// n_threads counts the calling thread. If fewer threads can be started,
+// the ones that did take over the work. report may be NULL.
+CSError Batch_generate(const struct BatchJob * jobs, unsigned n_jobs, unsigned n_threads, unsigned seed,
+                       BatchSink sink, void * ctx, struct BatchReport * report);
+void    BatchReport_print(FILE * f, const struct BatchReport * report);
+void    BatchReport_destroy(struct BatchReport * report);
+
+#endif // BATCH_H
@@ -1,4 +1,5 @@
 #include "Board.h"
+#include "PackedGrid.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,11 +7,14 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <pthread.h>
 #include "simple_solver/LNode.h"
 #include "simple_solver/Problem.h"
-#include "simple_solver/QueueSet_void_ptr.h"
+#include "simple_solver/Worklist.h"
+#include "bitboard_solver/EasySolver.h"
 
 #define SAVEFILE_NAME ".last_session"
+#define BOARD_TRACE_CAPACITY (1 << 16) // Events, 1.5 MB
 #ifndef min
 #        define min(x,y) ((x) < (y)?(x):(y))
 #endif
@@ -18,7 +22,6 @@
 #        define max(x,y) ((x) > (y)?(x):(y))
 #endif
 #define IS_WALL(type) ((type) == WALL)
-#define RANDOM(n) (int)(rand() / ((double)RAND_MAX / (n)  + 1))
 Vector Directions[4] = {{.x = 0,  .y = -1},
                         {.x = 0,  .y = 1},
                         {.x = -1, .y = 0},
@@ -28,6 +31,13 @@ typedef enum {ACTIVE = 0, INACTIVE = 1, TABOO = 2} State;
 
 typedef enum {EASY = 0, HARD = 1} Difficulty;
 
+// How Board_reduce() undoes a removal trial
+// REDUCE_PARALLEL: like REDUCE_DAG, several trials at a time on copies of the problem
+typedef enum {REDUCE_DAG = 0, REDUCE_TRAIL = 1, REDUCE_PARALLEL = 2} ReduceMode;
+
+// Which solver Board_reduce() and Board_get_hint() use
+typedef enum {ENGINE_SIMPLE = 0, ENGINE_BITBOARD = 1} Engine;
+
 struct TileData {
         State               state;
         bitset              old_domain;
@@ -36,20 +46,71 @@ struct TileData {
         struct Constraint * constraints[5];
 };
 
+// Board_get_hint(): the problem kept in step with the player's board, see Live hints
+struct LiveHints {
+        unsigned        live;        // The tile vars hold the player's board
+        struct LNode ** proposals;   // By constraint: the tiles its last run could decide
+        unsigned      * n_proposals; // By tile: how many constraints can decide it
+        unsigned      * decidable;   // The tiles some constraint can decide, in no order
+        unsigned      * position;    // By tile: where it is in decidable
+        unsigned        n_decidable;
+};
+
 struct UndoAction {
         struct Tile * tile;
         Type          old_type;
         Type          new_type;
 };
 
+// REDUCE_PARALLEL: one thread trying removals on its own copy of the problem
+struct ReduceWorker {
+        struct ProblemData * pdata;     // Worker 0 runs on the calling thread, with the board's own
+        pthread_t            thread;
+        unsigned             generation; // Last round it took part in
+        unsigned             n_synced;   // Committed removals applied to its problem so far
+        int                  candidate;  // Tile to try removing this round, or -1
+        unsigned             unique;     // Whether the board stayed unique without it
+        struct ReducePool  * pool;
+};
+
+struct ReducePool {
+        pthread_mutex_t      lock;
+        pthread_cond_t       go;         // A round has started
+        pthread_cond_t       finished;   // The last worker is done with it
+        unsigned             generation;
+        unsigned             n_pending;
+        unsigned             quit;
+
+        unsigned           * removed;    // Committed removals, in order
+        unsigned             n_removed;
+        unsigned           * untried;    // Tiles of the batch not settled yet, in order
+        unsigned             optimistic; // This round, whether worker k also removes untried[0..k)
+
+        unsigned             n_workers;  // Threads that actually started, plus the calling one
+        struct ReduceWorker  workers[];
+};
+static void ReducePool_destroy(struct ReducePool * pool);
+
 struct ProblemData {
         struct Problem * problem;
 
         unsigned       * order;
         unsigned         i;
 
+        ReduceMode       reduce_mode;
+        unsigned       * checkpoints; // REDUCE_TRAIL: trail position before order[k] was applied
+        unsigned         n_threads;   // REDUCE_PARALLEL: how many trials at a time
+        struct ReducePool * pool;
+
+        unsigned         minimal; // Keep only the givens a complete search needs
+
+        Difficulty           difficulty;
+        Engine               engine;
+        struct EasySolver  * bitboard; // ENGINE_BITBOARD: the givens and their propagation
+
         unsigned         n_empty;
         struct LNode   * mistakes;
+        struct LiveHints hints;
 
         unsigned         length;
         struct TileData  tile_data[];
@@ -68,7 +129,7 @@ void int2tile(Type i, struct Tile * tile)
         tile->value = (i >= 0) ? i : 0;
 }
 
-unsigned * get_random_order(unsigned size)
+unsigned * get_random_order(unsigned size, struct Rng * rng)
 {
         unsigned * ret = NULL;
         ret = malloc(size * sizeof(unsigned));
@@ -76,10 +137,11 @@ unsigned * get_random_order(unsigned size)
         for (unsigned i = 0; i < size; i++) {
                 ret[i] = i;
         }
-        for (int i = size - 1; i > 1; i--) {
-                int j = rand() / ((double)RAND_MAX / i + 1);
-                unsigned swap = ret[i];
-                ret[i] = ret[j];
+        // Fisher-Yates: ret[i - 1] swaps with any of ret[0..i)
+        for (unsigned i = size; i > 1; i--) {
+                unsigned j = Rng_below(rng, i);
+                unsigned swap = ret[i - 1];
+                ret[i - 1] = ret[j];
                 ret[j] = swap;
         }
         return ret;
@@ -88,15 +150,32 @@ unsigned * get_random_order(unsigned size)
 
 unsigned bools_are_single(struct ProblemData * pdata)
 {
+        struct Problem * p = pdata->problem;
         for (unsigned i = 0; i < pdata->length; i++) {
-                if (pdata->tile_data[i].var->domain == (RED | BLUE) ||
-                    pdata->tile_data[i].var->domain == 0) {
+                bitset domain = P_domain(p, pdata->tile_data[i].var);
+                if (domain == (RED | BLUE) || domain == 0) {
                             // printf("NOT SINGLE: %u\n", i);
                         return 0;
                 }
         }
         return 1;
 }
+// Whether the givens in place leave a single solution.
+// Propagation alone is enough to say yes; in minimal mode a search settles the rest.
+static unsigned PData_is_unique(struct ProblemData * pdata)
+{
+        if (bools_are_single(pdata)) {
+                return 1;
+        }
+        if (!pdata->minimal) {
+                return 0;
+        }
+        unsigned n_solutions = 0;
+        CSError fail = Problem_count_solutions(pdata->problem, pdata->tile_data[0].var, pdata->length,
+                                               2, &n_solutions);
+        return NO_FAILURE == fail && 1 == n_solutions;
+}
+
 bitset t2bits(struct Tile * tile) {
         bitset b = 0;
         switch (tile->type) {
@@ -115,18 +194,6 @@ bitset t2bits(struct Tile * tile) {
 }
 
 
-/**
- * return: -1 if can't traverse
- *         else the index of the next tile
- */
-int Grid_traverse(struct Grid * board, int index, Vector v)
-{
-        int x = v.x + (index % board->width),
-            y = v.y + (index / board->width);
-        int oob = !(x < 0 || x >= board->width || y < 0 || y >= board->height);
-        return (y * board->width + x) * oob - !oob;
-}
-
 struct Grid * Grid_create(int width, int height)
 {
         unsigned length = width * height;
@@ -143,13 +210,6 @@ struct Grid * Grid_create(int width, int height)
                 board->tiles[i].type = NUMBER;
                 board->tiles[i].value = length;
         }
-        for (unsigned i = 0; i < length; i++) {
-                for (unsigned d = 0; d < 4; d++) {
-                        const Vector dir = Directions[d];
-                        int j = Grid_traverse(board, i, dir);
-                        board->tiles[i].dir[d] = (j == -1) ? NULL : &board->tiles[j];
-                }
-        }
         return board;
 bad_alloc1:
         return NULL;
@@ -162,9 +222,6 @@ void Grid_free(struct Grid * board)
 }
 void Grid_copy_to(struct Grid * grid1, struct Grid * grid2)
 {
-        printf("%u == %u\n",grid1->width, grid2->width);
-        printf("%u == %u\n",grid1->height, grid2->height);
-        printf("%u == %u\n",grid1->length, grid2->length);
         assert(grid1->width == grid2->width);
         assert(grid1->height == grid2->height);
         assert(grid1->length == grid2->length);
@@ -201,112 +258,211 @@ void Grid_print(struct Grid * board)
 }
 
 
-#define TRAVERSE(t, direction) ((t) = (t)->dir[(direction)])
+////////
+// Segments
+////////
+// Maxify's index of the walls: the runs of non-wall tiles along each row
+// and each column. A tile sees the rest of its row run and of its column run,
+// so its count is two lookups, and a new wall only splits the two runs it
+// was in. Runs are numbered; a split keeps the number for the part before
+// the wall and numbers the part after it anew.
+
+enum {SEG_ROW, SEG_COLUMN};
+static const Direction seg_forward[2] = {RIGHT, DOWN};
+static const Direction seg_backward[2] = {LEFT, UP};
 
-unsigned count_tiles_in_range(struct Grid * board, struct Tile * tile)
+// Walls and the border both end a run or a ray
+#define PG_BLOCKS(type) (IS_WALL(type) || PG_EDGE == (type))
+
+struct Segments {
+        unsigned * of_cell[2]; // Row and column run of each cell
+        unsigned * length;     // Of each run, by number
+        unsigned   n_segments;
+};
+
+static CSError Segments_init(struct Segments * s, struct PackedGrid * g)
 {
-        unsigned count = 0;
-        for (Direction d = 0; d < 4; d++) {
-                struct Tile * t = tile;
-                while ((t = t->dir[d])) {
-                        if (IS_WALL(t->type))
-                                break;
-                        count++;
+        unsigned n_cells = g->stride * (g->height + 2);
+        s->of_cell[SEG_ROW] = malloc(2 * n_cells * sizeof(unsigned));
+        if (!s->of_cell[SEG_ROW]) {
+                goto bad_alloc1;
+        }
+        s->of_cell[SEG_COLUMN] = &s->of_cell[SEG_ROW][n_cells];
+        // Number the runs the grid starts with, which may already have walls
+        unsigned n_open = 0;
+        s->n_segments = 0;
+        for (unsigned axis = SEG_ROW; axis <= SEG_COLUMN; axis++) {
+                int back = g->step[seg_backward[axis]];
+                for (int y = 0; y < g->height; y++) {
+                        int j = (y + 1) * g->stride + 1;
+                        for (int x = 0; x < g->width; x++, j++) {
+                                if (IS_WALL(g->type[j])) {
+                                        continue;
+                                }
+                                n_open += SEG_ROW == axis;
+                                if (!PG_BLOCKS(g->type[j + back])) {
+                                        s->of_cell[axis][j] = s->of_cell[axis][j + back];
+                                } else {
+                                        s->of_cell[axis][j] = s->n_segments++;
+                                }
+                        }
+                }
+        }
+        // Each cell can become a wall once, which adds two runs
+        unsigned capacity = s->n_segments + 2 * n_open;
+        s->length = calloc(capacity, sizeof(unsigned));
+        if (!s->length) {
+                goto bad_alloc2;
+        }
+        for (int y = 0; y < g->height; y++) {
+                int j = (y + 1) * g->stride + 1;
+                for (int x = 0; x < g->width; x++, j++) {
+                        if (!IS_WALL(g->type[j])) {
+                                s->length[s->of_cell[SEG_ROW][j]]++;
+                                s->length[s->of_cell[SEG_COLUMN][j]]++;
+                        }
+                }
+        }
+        return NO_FAILURE;
+bad_alloc2:
+        free(s->of_cell[SEG_ROW]);
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+static void Segments_destroy(struct Segments * s)
+{
+        free(s->of_cell[SEG_ROW]);
+        free(s->length);
+}
+
+// What a non-wall cell sees
+static inline unsigned Segments_count(struct Segments * s, int j)
+{
+        return s->length[s->of_cell[SEG_ROW][j]] + s->length[s->of_cell[SEG_COLUMN][j]] - 2;
+}
+
+// Cell j has just become a wall
+static void Segments_cut(struct Segments * s, struct PackedGrid * g, int j)
+{
+        for (unsigned axis = SEG_ROW; axis <= SEG_COLUMN; axis++) {
+                int step = g->step[seg_forward[axis]];
+                unsigned seg = s->of_cell[axis][j];
+                unsigned after = s->n_segments++;
+                unsigned n_after = 0;
+                for (int k = j + step; !PG_BLOCKS(g->type[k]); k += step) {
+                        s->of_cell[axis][k] = after;
+                        n_after++;
                 }
+                s->length[after] = n_after;
+                s->length[seg] -= n_after + 1;
         }
-        return count;
 }
 
-struct Tile * get_random_neighbor(struct Grid * board, struct Tile * tile)
+////////
+// Maxify
+////////
+
+// A cell to wall off along the rays from cell j, skipping its neighbours;
+// -1 if j has a single neighbour, which must not be cut off.
+static int get_random_neighbor(struct PackedGrid * g, int j, struct Rng * rng)
 {
-        struct Tile * cut = NULL;
+        int cut = -1;
         unsigned n = 1;
         unsigned count = 0;
         for (Direction d = 0; d < 4; d++) {
-                struct Tile * t = tile;
                 unsigned range = 0;
-                while (TRAVERSE(t, d)) {
+                for (int k = j + g->step[d]; PG_EDGE != g->type[k]; k += g->step[d]) {
                         count++;
                         if (range++ < 1)
                                 continue;
-                        if (IS_WALL(t->type))
+                        if (IS_WALL(g->type[k]))
                                 break;
-                        if (0 == (rand() % n++)) {
-                                cut = t;
+                        if (0 == Rng_below(rng, n++)) {
+                                cut = k;
                         }
                 }
         }
         if (1 == count) {
-                return NULL;
+                return -1;
         }
         return cut;
 }
-void update_values(struct Grid * board, struct Tile * tile)
+
+// Walls off cell j: the cells that saw past it see less
+static void update_values(struct PackedGrid * g, struct Segments * s, int j)
 {
+        g->type[j] = WALL;
+        g->value[j] = 0;
+        Segments_cut(s, g, j);
         for (Direction d = 0; d < 4; d++) {
-                struct Tile * t = tile;
-                while (TRAVERSE(t, d)) {
-                        if (IS_WALL(t->type))
-                                break;
-                        int2tile(count_tiles_in_range(board, t), t);
-                        if (t->value == 0) {
-                                int2tile(WALL, t);
+                for (int k = j + g->step[d]; !PG_BLOCKS(g->type[k]); k += g->step[d]) {
+                        g->type[k] = NUMBER;
+                        g->value[k] = Segments_count(s, k);
+                        if (g->value[k] == 0) {
+                                // Walled in on all four sides, so this ray ends here
+                                g->type[k] = WALL;
+                                Segments_cut(s, g, k);
                         }
                 }
         }
 }
 
-unsigned maxify(struct Grid * board, int maxAllowed)
+static unsigned maxify(struct PackedGrid * g, int maxAllowed, struct Rng * rng)
 {
-        srand(time(0));
-
-        struct QueueSet_void_ptr * Q = QueueSet_create_void_ptr(board->length);
-        if (!Q) {
+        // Cells to cut around, oldest first
+        struct Worklist Q;
+        if (NO_FAILURE != Worklist_init(&Q, g->stride * (g->height + 2))) {
                 goto bad_alloc1;
         }
-
-        unsigned * order = get_random_order(board->length);
+        unsigned * order = get_random_order(g->length, rng);
         if (!order) {
                 goto bad_alloc2;
         }
+        struct Segments segments;
+        if (NO_FAILURE != Segments_init(&segments, g)) {
+                goto bad_alloc3;
+        }
 
-        for (int i = 0; i < board->length; i++) {
-                unsigned index = order[i];
-                board->tiles[index].value = count_tiles_in_range(board, &board->tiles[index]);
-                if (board->tiles[index].value > maxAllowed) {
-                        QueueSet_insert_void_ptr(Q, &board->tiles[index]);
-                }
-        }
-        while (Q->n_entries != 0) {
-                void * ptr = NULL;
-                QueueSet_pop_void_ptr(Q, &ptr);
-                struct Tile * tile = ptr;
-                if (tile->value > maxAllowed) {
-                        struct Tile * cut = get_random_neighbor(board, tile);
-                        if (cut) {
-                                int2tile(WALL, cut);
-                                update_values(board, cut);
-                                if (tile->value > maxAllowed) {
-                                        QueueSet_insert_void_ptr(Q, tile);
-                                }
-                                for (Direction d = 0; d < 4; d++) {
-                                        struct Tile * t = cut;
-                                        while (TRAVERSE(t, d)) {
-                                                if (IS_WALL(t->type)) {
-                                                        break;
-                                                }
-                                                if (t->value > maxAllowed) {
-                                                        QueueSet_insert_void_ptr(Q, t);
-                                                }
-                                        }
+        for (int i = 0; i < g->length; i++) {
+                int j = PackedGrid_cell(g, order[i]);
+                if (IS_WALL(g->type[j])) {
+                        continue;
+                }
+                g->value[j] = Segments_count(&segments, j);
+                if (g->value[j] > maxAllowed) {
+                        Worklist_insert(&Q, j);
+                }
+        }
+        unsigned j;
+        while (NO_FAILURE == Worklist_pop(&Q, &j)) {
+                if (g->value[j] <= maxAllowed) {
+                        continue;
+                }
+                int cut = get_random_neighbor(g, j, rng);
+                if (cut < 0) {
+                        continue;
+                }
+                update_values(g, &segments, cut);
+                if (g->value[j] > maxAllowed) {
+                        Worklist_insert(&Q, j);
+                }
+                for (Direction d = 0; d < 4; d++) {
+                        for (int k = cut + g->step[d]; !PG_BLOCKS(g->type[k]); k += g->step[d]) {
+                                if (g->value[k] > maxAllowed) {
+                                        Worklist_insert(&Q, k);
                                 }
                         }
                 }
         }
+        Segments_destroy(&segments);
         free(order);
+        Worklist_destroy(&Q);
         return NO_FAILURE;
+bad_alloc3:
+        free(order);
 bad_alloc2:
-        QueueSet_destroy_void_ptr(Q);
+        Worklist_destroy(&Q);
 bad_alloc1:
         return FAIL_ALLOC;
 }
@@ -314,7 +470,7 @@ bad_alloc1:
 // ProblemData
 //////////////
 
-struct ProblemData * PData_create(struct Grid * grid, int difficulty)
+struct ProblemData * PData_create(struct Grid * grid, int difficulty, struct Rng * rng)
 {
 // Initialize things
         unsigned len = grid->length;
@@ -357,9 +513,18 @@ struct ProblemData * PData_create(struct Grid * grid, int difficulty)
         }
         pdata->problem = p;
         pdata->length = len;
-        pdata->order = get_random_order(len);
+        pdata->order = get_random_order(len, rng);
         pdata->i = 0;
+        pdata->reduce_mode = REDUCE_TRAIL;
+        pdata->checkpoints = NULL;
+        pdata->n_threads = 1;
+        pdata->pool = NULL;
+        pdata->minimal = 0;
+        pdata->difficulty = (HARD == difficulty) ? HARD : EASY;
+        pdata->engine = ENGINE_SIMPLE;
+        pdata->bitboard = NULL;
         pdata->mistakes = NULL;
+        pdata->hints = (struct LiveHints){0};
 
         unsigned max_tile_in_board = 0;
         for (unsigned i = 0; i < len; i++) {
@@ -370,9 +535,14 @@ struct ProblemData * PData_create(struct Grid * grid, int difficulty)
         if (!vars) {
                 goto bad_alloc3;
         }
+        // Rays are walked on the packed copy, which ends them at its border
+        struct PackedGrid g;
+        if (NO_FAILURE != PackedGrid_init(&g, grid->width, grid->height)) {
+                goto bad_alloc4;
+        }
+        PackedGrid_load(&g, grid);
 // Define the problem
         if (HARD == difficulty) {
-                printf("HARD\n");
                 for (unsigned i = 0; i < len; i++) {
                         if (grid->tiles[i].type != NUMBER) {
                                 continue;
@@ -381,11 +551,12 @@ struct ProblemData * PData_create(struct Grid * grid, int difficulty)
                         unsigned n_valid_directions = 0;
                         struct Var * dir[4];
 
+                        int j = PackedGrid_cell(&g, i);
                         for (Direction d = 0; d < 4; d++) {
-                                struct Tile * t = &grid->tiles[i];
                                 unsigned current_distance = 0;
-                                while((t = t->dir[d])) {
-                                        vars[current_distance++] = &tile_bools[t->id];
+                                int k = j + g.step[d];
+                                for (int id = i + g.id_step[d]; PG_EDGE != g.type[k]; k += g.step[d], id += g.id_step[d]) {
+                                        vars[current_distance++] = &tile_bools[id];
                                         if (current_distance == target_value + 1) {
                                                 break;
                                         }
@@ -411,7 +582,6 @@ struct ProblemData * PData_create(struct Grid * grid, int difficulty)
                         tile_data[i].constraints[tile_data[i].n_constraints++] = sum;
                 }
         } else {
-                printf("easy\n");
                 for (unsigned i = 0; i < len; i++) {
                         if (grid->tiles[i].type != NUMBER) {
                                 continue;
@@ -419,10 +589,11 @@ struct ProblemData * PData_create(struct Grid * grid, int difficulty)
                         unsigned target_value = grid->tiles[i].value;
                         unsigned current_distances[4] = {0,0,0,0};
                         unsigned n_neighbors = 0;
+                        int j = PackedGrid_cell(&g, i);
                         for (Direction d = 0; d < 4; d++) {
-                                struct Tile * t = &grid->tiles[i];
-                                while ((t = t->dir[d])) {
-                                        vars[n_neighbors++] = &tile_bools[t->id];
+                                int k = j + g.step[d];
+                                for (int id = i + g.id_step[d]; PG_EDGE != g.type[k]; k += g.step[d], id += g.id_step[d]) {
+                                        vars[n_neighbors++] = &tile_bools[id];
                                         current_distances[d]++;
                                         if (current_distances[d] == target_value + 1) {
                                                 break;
@@ -435,12 +606,18 @@ struct ProblemData * PData_create(struct Grid * grid, int difficulty)
                         tile_data[i].constraints[tile_data[i].n_constraints++] = tile;
                 }
         }
+        PackedGrid_destroy(&g);
         free(vars);
 
-        Problem_create_registry(p);
+        if (FAIL_ALLOC == Problem_create_registry(p)) {
+                goto bad_alloc3;
+        }
         Problem_solve(p);
         return pdata;
+bad_alloc4:
+        free(vars);
 bad_alloc3:
+        free(pdata->order);
         Problem_destroy(p);
 bad_alloc2:
         free(pdata);
@@ -448,10 +625,55 @@ bad_alloc1:
         return NULL;
 }
 
+// A copy of pdata over a clone of its problem, for a REDUCE_PARALLEL worker.
+// It has no order, and no engine besides ENGINE_SIMPLE.
+static struct ProblemData * PData_fork(struct ProblemData * pdata)
+{
+        size_t size = sizeof(struct ProblemData) + pdata->length * sizeof(struct TileData);
+        struct ProblemData * fork = malloc(size);
+        if (!fork) {
+                goto bad_alloc1;
+        }
+        memcpy(fork, pdata, size);
+        fork->problem = Problem_clone(pdata->problem);
+        if (!fork->problem) {
+                goto bad_alloc2;
+        }
+        fork->order = NULL;
+        fork->checkpoints = NULL;
+        fork->pool = NULL;
+        fork->engine = ENGINE_SIMPLE;
+        fork->bitboard = NULL;
+        fork->mistakes = NULL;
+        fork->hints = (struct LiveHints){0};
+        for (unsigned i = 0; i < fork->length; i++) {
+                struct TileData * td = &fork->tile_data[i];
+                td->var = P_var(fork->problem, td->var->id);
+                for (unsigned j = 0; j < td->n_constraints; j++) {
+                        td->constraints[j] = P_constraint(fork->problem, td->constraints[j]->id);
+                }
+        }
+        return fork;
+bad_alloc2:
+        free(fork);
+bad_alloc1:
+        return NULL;
+}
+
 void PData_destroy(struct ProblemData * pdata)
 {
+        if (pdata->pool) {
+                ReducePool_destroy(pdata->pool);
+        }
         if (pdata->problem) {
                 free(pdata->order);
+                free(pdata->checkpoints);
+                EasySolver_destroy(pdata->bitboard);
+                // The lists of proposals go with the problem's pool
+                free(pdata->hints.proposals);
+                free(pdata->hints.n_proposals);
+                free(pdata->hints.decidable);
+                free(pdata->hints.position);
                 Problem_destroy(pdata->problem);
         }
         free(pdata);
@@ -461,6 +683,380 @@ struct ProblemData * Board_pdata(struct Board * board)
         return board->private;
 }
 
+// Put a tile's given back: fix its colour and switch its constraints on
+static void PData_apply_tile(struct ProblemData * pdata, unsigned index)
+{
+        struct Problem * p = pdata->problem;
+        struct TileData * td = &pdata->tile_data[index];
+        for (unsigned j = 0; j < td->n_constraints; j++) {
+                Problem_constraint_activate(p, td->constraints[j]);
+        }
+        Problem_var_reset_domain(p, td->var, td->old_domain);
+}
+
+// Take a tile's given away: open its colour and switch its constraints off
+static void PData_remove_tile(struct ProblemData * pdata, unsigned index)
+{
+        struct Problem * p = pdata->problem;
+        struct TileData * td = &pdata->tile_data[index];
+        for (unsigned j = 0; j < td->n_constraints; j++) {
+                Problem_constraint_deactivate(p, td->constraints[j]);
+        }
+        Problem_var_reset_domain(p, td->var, BLUE | RED);
+}
+
+static void Board_settle_tile(struct Board * board, unsigned index, unsigned unique)
+{
+        struct ProblemData * pdata = board->private;
+        struct TileData * td = &pdata->tile_data[index];
+        if (! unique) {
+                td->state = TABOO;
+        } else {
+                td->state = INACTIVE;
+                pdata->n_empty++;
+        }
+
+        board->min_tile_mask[index] = (TABOO == td->state) ? 1 : 0;
+        if (TABOO != td->state) {
+                int2tile(EMPTY, &board->min_grid->tiles[index]);
+        }
+}
+
+// Each trial retracts the tile's consequences from the Restriction DAG,
+// propagates, and puts the tile back if the board became ambiguous.
+static void Board_reduce_DAG(struct Board * board, unsigned end)
+{
+        struct ProblemData * pdata = board->private;
+        struct Problem * p = pdata->problem;
+
+        for (unsigned i = pdata->i; i < end; i++) {
+                unsigned index = pdata->order[i];
+
+                PData_remove_tile(pdata, index);
+                int fail = Problem_solve_queue(p);
+                NOFAIL(fail);
+                (void)fail;
+                unsigned unique = PData_is_unique(pdata);
+                if (! unique) {
+                        PData_apply_tile(pdata, index);
+                }
+                Board_settle_tile(board, index, unique);
+        }
+}
+
+// Builds the checkpoint stack for Board_reduce_trail().
+// Starting from a board with no givens, the tiles are applied in reverse
+// order, so that backtracking to checkpoints[i] leaves exactly the tiles
+// order[i+1..] in place, already propagated.
+static CSError Board_reduce_trail_begin(struct Board * board)
+{
+        struct ProblemData * pdata = board->private;
+        struct Problem * p = pdata->problem;
+
+        pdata->checkpoints = malloc(pdata->length * sizeof(unsigned));
+        if (!pdata->checkpoints) {
+                goto bad_alloc1;
+        }
+        for (unsigned index = 0; index < pdata->length; index++) {
+                PData_remove_tile(pdata, index);
+        }
+        Problem_solve_queue(p);
+
+        Problem_set_trail_mode(p, 1);
+        for (unsigned k = pdata->length; k-- > 0;) {
+                pdata->checkpoints[k] = Problem_push_checkpoint(p);
+                PData_apply_tile(pdata, pdata->order[k]);
+                int fail = Problem_solve_queue(p);
+                NOFAIL(fail);
+                (void)fail;
+        }
+        return NO_FAILURE;
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+// Each trial backtracks to the state where only the untested tiles are given,
+// re-applies the tiles already kept, and propagates. No provenance is kept.
+// Once every tile is settled the trail is dropped and the kept tiles are
+// re-applied through the DAG, which Board_get_hint() relies on.
+static void Board_reduce_trail(struct Board * board, unsigned end)
+{
+        struct ProblemData * pdata = board->private;
+        struct Problem * p = pdata->problem;
+
+        for (unsigned i = pdata->i; i < end; i++) {
+                unsigned index = pdata->order[i];
+
+                Problem_backtrack_to(p, pdata->checkpoints[i]);
+                for (unsigned j = 0; j < i; j++) {
+                        if (TABOO == pdata->tile_data[pdata->order[j]].state) {
+                                PData_apply_tile(pdata, pdata->order[j]);
+                        }
+                }
+                int fail = Problem_solve_queue(p);
+                NOFAIL(fail);
+                (void)fail;
+                Board_settle_tile(board, index, PData_is_unique(pdata));
+        }
+
+        if (end == pdata->length) {
+                Problem_set_trail_mode(p, 0);
+                for (unsigned index = 0; index < pdata->length; index++) {
+                        if (TABOO == pdata->tile_data[index].state) {
+                                PData_apply_tile(pdata, index);
+                        }
+                }
+        }
+}
+
+// Same trials as Board_reduce_DAG(), but each one propagates the remaining
+// givens from scratch over the whole grid at once.
+static void Board_reduce_bitboard(struct Board * board, unsigned end)
+{
+        struct ProblemData * pdata = board->private;
+        struct EasySolver * s = pdata->bitboard;
+
+        for (unsigned i = pdata->i; i < end; i++) {
+                unsigned index = pdata->order[i];
+                struct Tile * given = &board->max_grid->tiles[index];
+
+                EasySolver_set_tile(s, index, BLUE | RED);
+                EasySolver_clear_number(s, index);
+                unsigned unique = (NO_FAILURE == EasySolver_solve(s)) && EasySolver_is_unique(s);
+                if (! unique) {
+                        EasySolver_set_tile(s, index, pdata->tile_data[index].old_domain);
+                        if (NUMBER == given->type) {
+                                EasySolver_set_number(s, index, given->value);
+                        }
+                }
+                Board_settle_tile(board, index, unique);
+        }
+}
+
+//////////
+// REDUCE_PARALLEL
+//////////
+// Each worker holds a full copy of the problem. A round hands out the first
+// untried tiles of the order, one per worker, and every worker tries removing
+// its own tile on top of the removals committed so far, guessing how the tiles
+// before it in the round turn out: all kept, or in an optimistic round all removed.
+// Removing givens only makes a board more ambiguous, so "has to stay" still
+// holds if fewer tiles were guessed removed than really are, and "removable"
+// if more were.
+// Verdicts are settled in order up to the first one that doesn't stand, and
+// the rest is tried again in the next round, except that in a pessimistic round
+// later tiles that have to stay are settled anyway: keeping them changes nothing.
+// Every removal is thus decided on top of exactly the removals before it, and
+// boards come out the same as with REDUCE_DAG.
+
+// Brings a worker's problem up to date, then tries its candidate if it has one
+static void ReduceWorker_step(struct ReduceWorker * w)
+{
+        struct ReducePool * pool = w->pool;
+        struct ProblemData * pdata = w->pdata;
+
+        for (; w->n_synced < pool->n_removed; w->n_synced++) {
+                PData_remove_tile(pdata, pool->removed[w->n_synced]);
+        }
+        if (w->candidate < 0) {
+                return;
+        }
+        unsigned n_guessed = pool->optimistic ? (unsigned)(w - pool->workers) : 0;
+        for (unsigned k = 0; k < n_guessed; k++) {
+                PData_remove_tile(pdata, pool->untried[k]);
+        }
+        PData_remove_tile(pdata, w->candidate);
+        int fail = Problem_solve_queue(pdata->problem);
+        NOFAIL(fail);
+        (void)fail;
+        w->unique = PData_is_unique(pdata);
+        PData_apply_tile(pdata, w->candidate);
+        for (unsigned k = 0; k < n_guessed; k++) {
+                PData_apply_tile(pdata, pool->untried[k]);
+        }
+}
+
+static void * ReduceWorker_run(void * arg)
+{
+        struct ReduceWorker * w = arg;
+        struct ReducePool * pool = w->pool;
+
+        pthread_mutex_lock(&pool->lock);
+        for (;;) {
+                while (!pool->quit && w->generation == pool->generation) {
+                        pthread_cond_wait(&pool->go, &pool->lock);
+                }
+                if (pool->quit) {
+                        break;
+                }
+                w->generation = pool->generation;
+                pthread_mutex_unlock(&pool->lock);
+
+                ReduceWorker_step(w);
+
+                pthread_mutex_lock(&pool->lock);
+                if (0 == --pool->n_pending) {
+                        pthread_cond_signal(&pool->finished);
+                }
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+}
+
+// Worker 0 is the calling thread and works on the board's own problem.
+// Starts fewer workers if threads or copies can't be had, down to that one.
+static struct ReducePool * ReducePool_create(struct Board * board, unsigned n_workers)
+{
+        struct ProblemData * pdata = board->private;
+        struct ReducePool * pool = malloc(sizeof(struct ReducePool) + n_workers * sizeof(struct ReduceWorker));
+        if (!pool) {
+                goto bad_alloc1;
+        }
+        pool->removed = malloc(2 * pdata->length * sizeof(unsigned));
+        if (!pool->removed) {
+                goto bad_alloc2;
+        }
+        pool->untried = &pool->removed[pdata->length];
+        if (pthread_mutex_init(&pool->lock, NULL)) {
+                goto bad_alloc3;
+        }
+        if (pthread_cond_init(&pool->go, NULL)) {
+                goto bad_alloc4;
+        }
+        if (pthread_cond_init(&pool->finished, NULL)) {
+                goto bad_alloc5;
+        }
+        pool->generation = 0;
+        pool->n_pending = 0;
+        pool->quit = 0;
+        pool->n_removed = 0;
+        pool->optimistic = 1;
+
+        for (unsigned k = 0; k < n_workers; k++) {
+                pool->workers[k] = (struct ReduceWorker) {
+                        .pdata = NULL, .generation = 0, .n_synced = 0,
+                        .candidate = -1, .unique = 0, .pool = pool
+                };
+        }
+        pool->workers[0].pdata = pdata;
+        pool->n_workers = 1;
+        for (unsigned k = 1; k < n_workers; k++) {
+                struct ReduceWorker * w = &pool->workers[k];
+                w->pdata = PData_fork(pdata);
+                if (!w->pdata) {
+                        break;
+                }
+                if (pthread_create(&w->thread, NULL, ReduceWorker_run, w)) {
+                        PData_destroy(w->pdata);
+                        break;
+                }
+                pool->n_workers++;
+        }
+        return pool;
+bad_alloc5:
+        pthread_cond_destroy(&pool->go);
+bad_alloc4:
+        pthread_mutex_destroy(&pool->lock);
+bad_alloc3:
+        free(pool->removed);
+bad_alloc2:
+        free(pool);
+bad_alloc1:
+        return NULL;
+}
+
+static void ReducePool_destroy(struct ReducePool * pool)
+{
+        pthread_mutex_lock(&pool->lock);
+        pool->quit = 1;
+        pthread_cond_broadcast(&pool->go);
+        pthread_mutex_unlock(&pool->lock);
+
+        for (unsigned k = 1; k < pool->n_workers; k++) {
+                pthread_join(pool->workers[k].thread, NULL);
+#if CS_STATS
+                // The board's problem takes over what its copies did
+                ProblemStats_add(&pool->workers[0].pdata->problem->stats,
+                                 &pool->workers[k].pdata->problem->stats);
+#endif
+                PData_destroy(pool->workers[k].pdata);
+        }
+        pthread_cond_destroy(&pool->finished);
+        pthread_cond_destroy(&pool->go);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->removed);
+        free(pool);
+}
+
+// Runs one step on every worker and waits for all of them
+static void ReducePool_round(struct ReducePool * pool)
+{
+        pthread_mutex_lock(&pool->lock);
+        pool->generation++;
+        pool->n_pending = pool->n_workers - 1;
+        pthread_cond_broadcast(&pool->go);
+        pthread_mutex_unlock(&pool->lock);
+
+        ReduceWorker_step(&pool->workers[0]);
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->n_pending > 0) {
+                pthread_cond_wait(&pool->finished, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+}
+
+static void Board_reduce_parallel(struct Board * board, unsigned end)
+{
+        struct ProblemData * pdata = board->private;
+        struct ReducePool * pool = pdata->pool;
+
+        unsigned * untried = pool->untried;
+        unsigned n_untried = 0;
+        for (unsigned i = pdata->i; i < end; i++) {
+                untried[n_untried++] = pdata->order[i];
+        }
+        while (n_untried > 0) {
+                unsigned n = min(pool->n_workers, n_untried);
+                for (unsigned k = 0; k < pool->n_workers; k++) {
+                        pool->workers[k].candidate = (k < n) ? (int)untried[k] : -1;
+                }
+                ReducePool_round(pool);
+
+                // Walk the verdicts in order, keeping the ones still to try at the front
+                unsigned n_removed = 0;
+                unsigned n_kept = 0;
+                unsigned n_left = 0;
+                for (unsigned k = 0; k < n; k++) {
+                        struct ReduceWorker * w = &pool->workers[k];
+                        unsigned stands = pool->optimistic
+                                ? (w->unique || 0 == n_kept)
+                                : (!w->unique || 0 == n_removed);
+                        if (!stands || n_left > 0) {
+                                if (pool->optimistic || w->unique) {
+                                        untried[n_left++] = w->candidate;
+                                        continue;
+                                }
+                        }
+                        if (w->unique) {
+                                pool->removed[pool->n_removed++] = w->candidate;
+                                n_removed++;
+                        } else {
+                                n_kept++;
+                        }
+                        Board_settle_tile(board, w->candidate, w->unique);
+                }
+                memmove(&untried[n_left], &untried[n], (n_untried - n) * sizeof(unsigned));
+                n_untried = n_left + n_untried - n;
+                // Guess the next round goes like this one
+                pool->optimistic = n_removed > n_kept;
+        }
+
+        // Leave the board's own problem with every removal so far
+        pool->workers[0].candidate = -1;
+        ReduceWorker_step(&pool->workers[0]);
+}
+
 //////////
 // Board
 //////////
@@ -473,39 +1069,114 @@ double Board_reduce(struct Board * board, unsigned batch_size)
         struct Problem * p = pdata->problem;
 
         batch_size = (batch_size <= 0) ? pdata->length : batch_size;
-        unsigned i;
-        for (i = pdata->i; i < min(pdata->i + batch_size, pdata->length); i++) {
-                unsigned index = pdata->order[i];
-                struct TileData * td = &pdata->tile_data[index];
-
-                for (unsigned j = 0; j < td->n_constraints; j++) {
-                        Problem_constraint_deactivate(p, td->constraints[j]);
-                }
-                Problem_var_reset_domain(p, td->var, BLUE | RED);
-                int fail = Problem_solve_queue(p);
-                NOFAIL(fail);
-                if (! bools_are_single(pdata)) {
-                        for (unsigned j = 0; j < td->n_constraints; j++) {
-                                Problem_constraint_activate(p, td->constraints[j]);
-                        }
-                        Problem_var_reset_domain(p, td->var, td->old_domain);
-                        td->state = TABOO;
-                } else {
-                        td->state = INACTIVE;
-                        pdata->n_empty++;
+        unsigned end = min(pdata->i + batch_size, pdata->length);
+        if (ENGINE_BITBOARD == pdata->engine) {
+                Board_reduce_bitboard(board, end);
+                pdata->i = end;
+                return (double)pdata->i / pdata->length;
+        }
+        if (REDUCE_TRAIL == pdata->reduce_mode) {
+                if (0 == pdata->i && FAIL_ALLOC == Board_reduce_trail_begin(board)) {
+                        pdata->reduce_mode = REDUCE_DAG;
                 }
-
-                board->min_tile_mask[index] = (TABOO == td->state) ? 1 : 0;
-                if (TABOO != td->state) {
-                        int2tile(EMPTY, &board->min_grid->tiles[index]);
+        }
+        if (REDUCE_PARALLEL == pdata->reduce_mode && 0 == pdata->i) {
+                pdata->pool = ReducePool_create(board, pdata->n_threads);
+                if (!pdata->pool) {
+                        pdata->reduce_mode = REDUCE_DAG;
                 }
         }
-        pdata->i = i;
+        if (REDUCE_TRAIL == pdata->reduce_mode) {
+                Board_reduce_trail(board, end);
+        } else if (REDUCE_PARALLEL == pdata->reduce_mode) {
+                Board_reduce_parallel(board, end);
+        } else {
+                Board_reduce_DAG(board, end);
+        }
+        pdata->i = end;
+        if (pdata->pool && end == pdata->length) {
+                ReducePool_destroy(pdata->pool);
+                pdata->pool = NULL;
+        }
 
+        if (P_trail_mode(p)) {
+                // Mid-reduction: the trail is not at a state worth propagating
+                return (double)pdata->i / pdata->length;
+        }
         Problem_solve(p);
         return (double)pdata->i / pdata->length;
 }
 
+// Only takes effect before the first call to Board_reduce()
+void Board_set_reduce_mode(struct Board * board, int mode)
+{
+        struct ProblemData * pdata = Board_pdata(board);
+        if (pdata && 0 == pdata->i) {
+                pdata->reduce_mode = (REDUCE_TRAIL == mode) ? REDUCE_TRAIL : REDUCE_DAG;
+        }
+}
+
+// Only takes effect before the first call to Board_reduce().
+// More than one thread, counting the caller, switches to REDUCE_PARALLEL;
+// one switches back to the default. ENGINE_BITBOARD still takes precedence.
+void Board_set_reduce_threads(struct Board * board, unsigned n_threads)
+{
+        struct ProblemData * pdata = Board_pdata(board);
+        if (!pdata || 0 != pdata->i) {
+                return;
+        }
+        if (n_threads > 1) {
+                pdata->n_threads = n_threads;
+                pdata->reduce_mode = REDUCE_PARALLEL;
+        } else if (REDUCE_PARALLEL == pdata->reduce_mode) {
+                pdata->n_threads = 1;
+                pdata->reduce_mode = REDUCE_TRAIL;
+        }
+}
+
+// Only takes effect before the first call to Board_reduce().
+// A minimal puzzle may need more than propagation to solve, so hints can run dry.
+// Only ENGINE_SIMPLE can search, so this switches back to it.
+void Board_set_minimal(struct Board * board, int enabled)
+{
+        struct ProblemData * pdata = Board_pdata(board);
+        if (pdata && 0 == pdata->i) {
+                pdata->minimal = !!enabled;
+                if (pdata->minimal) {
+                        pdata->engine = ENGINE_SIMPLE;
+                }
+        }
+}
+
+// Only takes effect before the first call to Board_reduce().
+// ENGINE_BITBOARD only covers EASY boards of up to BB_MAX_TILES tiles, outside of
+// minimal mode; others keep ENGINE_SIMPLE.
+void Board_set_engine(struct Board * board, int engine)
+{
+        struct ProblemData * pdata = Board_pdata(board);
+        if (!pdata || 0 != pdata->i) {
+                return;
+        }
+        pdata->engine = ENGINE_SIMPLE;
+        if (ENGINE_BITBOARD != engine || EASY != pdata->difficulty || pdata->minimal) {
+                return;
+        }
+        if (!pdata->bitboard) {
+                pdata->bitboard = EasySolver_create(board->width, board->height);
+                if (!pdata->bitboard) {
+                        return;
+                }
+                for (unsigned i = 0; i < pdata->length; i++) {
+                        struct Tile * t = &board->min_grid->tiles[i];
+                        EasySolver_set_tile(pdata->bitboard, i, pdata->tile_data[i].old_domain);
+                        if (NUMBER == t->type) {
+                                EasySolver_set_number(pdata->bitboard, i, t->value);
+                        }
+                }
+        }
+        pdata->engine = ENGINE_BITBOARD;
+}
+
 CSError Board_allocate_grids(struct Board * board, unsigned width, unsigned height)
 {
         unsigned length = width * height;
@@ -532,8 +1203,25 @@ bad_alloc1:
         return FAIL_ALLOC;
 }
 
+// Seed for a board nobody chose one for: the time, told apart within a second by a count
+static unsigned Board_fresh_seed(void)
+{
+        static unsigned n_boards = 0;
+        unsigned k = __atomic_fetch_add(&n_boards, 1, __ATOMIC_RELAXED);
+        return (unsigned)time(0) ^ (k * 0x9e3779b9u);
+}
+
 struct Board * Board_create(unsigned width, unsigned height)
 {
+        return Board_create_seeded(width, height, Board_fresh_seed());
+}
+
+struct Board * Board_create_seeded(unsigned width, unsigned height, unsigned seed)
+{
+        // The generator keeps what a tile sees in a byte
+        if (width + height > PG_MAX_VALUE + 2) {
+                goto bad_param;
+        }
         struct Board * board = malloc(sizeof(struct Board));
         if (!board) {
                 goto bad_alloc1;
@@ -543,18 +1231,27 @@ struct Board * Board_create(unsigned width, unsigned height)
         board->min_tile_mask = NULL;
         board->private = NULL;
         board->undo_stack = NULL;
+        board->pool = PoolSet_create();
+        if (!board->pool) {
+                goto bad_alloc2;
+        }
         board->length = width * height;
         board->width = width;
         board->height = height;
+        board->seed = seed;
+        Rng_seed(&board->rng, seed);
         CSError fail = Board_allocate_grids(board, width, height);
 
         if (fail) {
-                goto bad_alloc2;
+                goto bad_alloc3;
         }
         return board;
+bad_alloc3:
+        PoolSet_destroy(board->pool);
 bad_alloc2:
         free(board);
 bad_alloc1:
+bad_param:
         return NULL;
 }
 
@@ -567,13 +1264,15 @@ void Board_destroy(struct Board * board)
                 if (board->private) {
                         PData_destroy(board->private);
                 }
+                // Undo actions and the list of mistakes live here
+                PoolSet_destroy(board->pool);
                 free(board);
         }
 }
 
 void Board_init_problem(struct Board * board, int difficulty)
 {
-        board->private = PData_create(board->min_grid, difficulty);
+        board->private = PData_create(board->min_grid, difficulty, &board->rng);
 }
 unsigned Board_maxify(struct Board * board, unsigned max_tile)
 {
@@ -581,14 +1280,197 @@ unsigned Board_maxify(struct Board * board, unsigned max_tile)
                 goto no_board;
         }
 
-        maxify(board->max_grid, max_tile);
+        struct PackedGrid g;
+        if (NO_FAILURE != PackedGrid_init(&g, board->width, board->height)) {
+                goto bad_alloc1;
+        }
+        PackedGrid_load(&g, board->max_grid);
+        if (NO_FAILURE != maxify(&g, max_tile, &board->rng)) {
+                goto bad_alloc2;
+        }
+        PackedGrid_store(&g, board->max_grid);
+        PackedGrid_destroy(&g);
         Grid_copy_to(board->max_grid, board->min_grid);
 
         return NO_FAILURE;
+bad_alloc2:
+        PackedGrid_destroy(&g);
+bad_alloc1:
+        return FAIL_ALLOC;
 no_board:
         return FAIL_PARAM;
 }
 
+////////
+// Live hints
+////////
+// Board_get_hint() works on the problem kept in step with the player's board.
+// The tile vars hold the player's tiles, as roots of the Restriction DAG, and
+// only the other vars are propagated: a filter that can decide a tile
+// proposes it instead, and what each constraint proposed stands until it
+// runs again. A move resets one tile var, which retracts what was derived
+// from it and queues the constraints it is in. The next hint drains the
+// queue and takes any tile still proposed.
+
+static CSError PData_hints_init(struct ProblemData * pdata)
+{
+        struct LiveHints * h = &pdata->hints;
+        h->proposals = calloc(pdata->problem->n_constraints, sizeof(struct LNode *));
+        if (!h->proposals) {
+                goto bad_alloc1;
+        }
+        h->n_proposals = calloc(pdata->length, sizeof(unsigned));
+        if (!h->n_proposals) {
+                goto bad_alloc2;
+        }
+        h->decidable = malloc(pdata->length * sizeof(unsigned));
+        if (!h->decidable) {
+                goto bad_alloc3;
+        }
+        h->position = malloc(pdata->length * sizeof(unsigned));
+        if (!h->position) {
+                goto bad_alloc4;
+        }
+        h->n_decidable = 0;
+        h->live = 0;
+        return NO_FAILURE;
+bad_alloc4:
+        free(h->decidable);
+bad_alloc3:
+        free(h->n_proposals);
+bad_alloc2:
+        free(h->proposals);
+bad_alloc1:
+        *h = (struct LiveHints){0};
+        return FAIL_ALLOC;
+}
+
+static CSError PData_hints_propose(struct ProblemData * pdata, struct Constraint * c, unsigned index)
+{
+        struct LiveHints * h = &pdata->hints;
+        if (FAIL_ALLOC == LNode_prepend_pool(&pdata->problem->pool, &h->proposals[c->id], NULL, index)) {
+                goto bad_alloc1;
+        }
+        if (0 == h->n_proposals[index]++) {
+                h->position[index] = h->n_decidable;
+                h->decidable[h->n_decidable++] = index;
+        }
+        return NO_FAILURE;
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+// Drops what the constraint proposed on its last run
+static void PData_hints_withdraw(struct ProblemData * pdata, unsigned c_id)
+{
+        struct LiveHints * h = &pdata->hints;
+        struct LNode ** proposals = &h->proposals[c_id];
+        while (*proposals) {
+                unsigned index = (*proposals)->integer;
+                LNode_pop_pool(&pdata->problem->pool, proposals);
+                if (0 == --h->n_proposals[index]) {
+                        unsigned last = h->decidable[--h->n_decidable];
+                        h->decidable[h->position[index]] = last;
+                        h->position[last] = h->position[index];
+                }
+        }
+}
+
+// Puts the player's board into the tile vars, and queues every constraint
+static CSError PData_hints_begin(struct ProblemData * pdata, struct Grid * grid)
+{
+        struct Problem * p = pdata->problem;
+        if (!pdata->hints.proposals && NO_FAILURE != PData_hints_init(pdata)) {
+                goto bad_alloc1;
+        }
+        for (unsigned c_i = 0; c_i < p->n_constraints; c_i++) {
+                PData_hints_withdraw(pdata, c_i);
+        }
+        for (unsigned i = 0; i < pdata->length; i++) {
+                if (FAIL_ALLOC == Problem_var_reset_domain(p, pdata->tile_data[i].var, t2bits(&grid->tiles[i]))) {
+                        goto bad_alloc1;
+                }
+        }
+        for (unsigned c_i = 0; c_i < p->n_constraints; c_i++) {
+                if (p->c_registry[c_i].active) {
+                        Problem_enqueue(p, c_i);
+                }
+        }
+        pdata->hints.live = 1;
+        return NO_FAILURE;
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+// Propagates what changed since the last hint. FAILURE if the player's board
+// contradicts itself, FAIL_ALLOC if a proposal could not be kept.
+static CSError PData_hints_drain(struct ProblemData * pdata)
+{
+        struct Problem * p = pdata->problem;
+        struct Var * tile_vars = pdata->tile_data[0].var;
+        CSError fail = NO_FAILURE;
+        P_TRACE(p, TRACE_DRAIN_BEGIN, 0, Problem_queue_length(p), 0, 0);
+        while ( ! Problem_queue_is_empty(p)) {
+                unsigned c_id = 0;
+                fail = Problem_dequeue(p, &c_id);
+                NOFAIL(fail);
+                struct Constraint * c = p->c_registry[c_id].constraint;
+                if ( ! P_cons_is_active(p, c)) {
+                        continue;
+                }
+                PData_hints_withdraw(pdata, c_id);
+                struct LNode * restrictions = NULL;
+                P_STATS(p, filter_calls[c->kind]++);
+                P_STATS(p, filter_quiet += Constraint_is_quiet(c));
+                P_TRACE(p, TRACE_FILTER, c->id, Constraint_is_quiet(c), 0, c->kind);
+                fail = Constraint_filter(c, &restrictions);
+                if (FAILURE == fail) {
+                        goto infeasible;
+                }
+                NOFAIL(fail);
+
+                while (restrictions) {
+                        struct Restriction * r = LNode_pop_pool(&p->pool, &restrictions);
+
+                        // POTENTIAL FIXME: noncompliant
+                        ptrdiff_t v_i = (r->var - tile_vars);
+                        if (v_i >= 0 && v_i < pdata->length) {
+                                Restriction_destroy(&p->pool, r);
+                                if (FAIL_ALLOC == PData_hints_propose(pdata, c, v_i)) {
+                                        Restriction_list_destroy(&p->pool, &restrictions);
+                                        goto bad_alloc1;
+                                }
+                                continue;
+                        }
+                        bitset old = P_domain(p, r->var);
+                        r->domain &= old;
+                        if (r->domain == old) {
+                                Restriction_destroy(&p->pool, r);
+                                P_STATS(p, restrictions_redundant++);
+                                continue;
+                        }
+                        if (r->domain == 0) {
+                                Restriction_destroy(&p->pool, r);
+                                Restriction_list_destroy(&p->pool, &restrictions);
+                                goto infeasible;
+                        }
+                        P_TRACE(p, TRACE_NARROW, r->var->id, r->domain, c->id, c->kind);
+                        fail = Problem_add_DAG_node(p, r);
+                        NOFAIL(fail);
+                        Problem_notify(p, r->var, bitset_events(old, r->domain), NULL);
+                }
+        }
+        P_TRACE(p, TRACE_DRAIN_END, 0, 0, 0, 0);
+        return NO_FAILURE;
+bad_alloc1:
+        P_TRACE(p, TRACE_DRAIN_END, 0, 1, 0, 0);
+        return FAIL_ALLOC;
+infeasible:
+        P_STATS(p, infeasible++);
+        P_TRACE(p, TRACE_DRAIN_END, 0, 1, 0, 0);
+        return FAILURE;
+}
+
 struct Hint Board_get_hint(struct Board * board)
 {
         struct ProblemData * pdata = Board_pdata(board);
@@ -597,56 +1479,35 @@ struct Hint Board_get_hint(struct Board * board)
                 ret.tile = pdata->mistakes->data;
                 ret.id = ret.tile->id;
                 ret.type = board->max_grid->tiles[ret.id].type;
+        } else if (ENGINE_BITBOARD == pdata->engine) {
+                // Board_set_tile() keeps the givens in step with the player's board.
+                // A round takes in the whole grid at once, so there is nothing
+                // more to carry from one hint to the next.
+                unsigned index;
+                bitset domain;
+                if (NO_FAILURE == EasySolver_find_deduction(pdata->bitboard, &index, &domain)) {
+                        ret.tile = &board->min_grid->tiles[index];
+                        ret.id = (int)index;
+                        ret.type = board->max_grid->tiles[ret.id].type;
+                }
         } else {
-                // There are no mistakes so invoke the solver
-                // Set the problem to the current board state
-                struct Problem * p = pdata->problem;
-                struct QueueSet_void_ptr * Q = p->Q;
-                for (unsigned i = 0; i < board->length; i++) {
-                        Problem_var_reset_domain(pdata->problem,
-                                                 pdata->tile_data[i].var,
-                                                 t2bits(&board->min_grid->tiles[i]));
-                }
-                for (unsigned c_i = 0; c_i < p->n_constraints; c_i++) {
-                        struct ConstraintRegister * c = &p->c_registry[c_i];
-                        if (c->active == 0) {
-                                continue;
-                        }
-                        QueueSet_insert_void_ptr(Q, c->constraint);
+                // There are no mistakes, so whatever a constraint can decide is news
+                struct LiveHints * h = &pdata->hints;
+                if (!h->live && NO_FAILURE != PData_hints_begin(pdata, board->min_grid)) {
+                        return ret;
                 }
-                int fail = NO_FAILURE;
-                while (Q->n_entries != 0) {
-                        // Pop from Queue
-                        struct Constraint * c = NULL;
-                        fail = QueueSet_pop_void_ptr(Q, (void**)&c);
-                        NOFAIL(fail);
-                        if ( ! P_cons_is_active(p, c)) {
-                                continue;
-                        }
-                        struct LNode * restrictions = NULL;
-                        fail = Constraint_filter(c, &restrictions);
-                        NOFAIL(fail);
-
-                        while (restrictions) {
-                                struct Restriction * r = LNode_pop(&restrictions);
-
-                                // POTENTIAL FIXME: noncompliant
-                                ptrdiff_t v_i = (r->var - pdata->tile_data[0].var);
-                                if (v_i >= 0 && v_i < board->length) {
-                                        ret.tile = &board->min_grid->tiles[v_i];
-                                        ret.id = (int)v_i;
-                                        ret.type = board->max_grid->tiles[ret.id].type;
-                                        free(r);
-                                        LNode_destroy_and_free_data(&restrictions);
-                                        break;
-                                }
-                                // assert(! HashSet_contains_void_ptr(pdata->vars_set, arc.var));
-                                // assert(HashSet_contains_void_ptr(pdata->vars_set, pdata->tile_data[0].var));
-
-                                fail = Problem_add_DAG_node(p, r);
-                                NOFAIL(fail);
-                                assert(r->var->domain);
-                                Problem_enqueue_related_constraints(p, r->var);
+                if (NO_FAILURE != PData_hints_drain(pdata)) {
+                        // Start over on the next hint
+                        h->live = 0;
+                        return ret;
+                }
+                for (unsigned k = 0; k < h->n_decidable; k++) {
+                        unsigned index = h->decidable[k];
+                        if (EMPTY == board->min_grid->tiles[index].type) {
+                                ret.tile = &board->min_grid->tiles[index];
+                                ret.id = (int)index;
+                                ret.type = board->max_grid->tiles[ret.id].type;
+                                break;
                         }
                 }
         }
@@ -681,41 +1542,54 @@ void Board_set_tile(struct Board * board, struct Tile * tile, int state)
 // Actually set the tile
         int2tile(state, tile);
 
+// Keep the problem Board_get_hint() works on in step
+        struct ProblemData * pdata = Board_pdata(board);
+        if (ENGINE_BITBOARD == pdata->engine) {
+                EasySolver_set_tile(pdata->bitboard, index, t2bits(tile));
+        } else if (pdata->hints.live &&
+                   FAIL_ALLOC == Problem_var_reset_domain(pdata->problem, pdata->tile_data[index].var, t2bits(tile))) {
+                pdata->hints.live = 0;
+        }
+
 // Modify the list of mistakes as necessary
         int correct_state = board->max_grid->tiles[index].type;
         if ((state == FILLED && correct_state == WALL) ||
             (state == WALL && correct_state == NUMBER)) {
-                LNode_prepend(&Board_pdata(board)->mistakes, tile, index);
+                LNode_prepend_pool(board->pool, &Board_pdata(board)->mistakes, tile, index);
         } else {
                 // Make sure this node is not in the list of wrong tiles
-                LNode_remove_node(&Board_pdata(board)->mistakes, tile);
+                LNode_remove_node_pool(board->pool, &Board_pdata(board)->mistakes, tile);
         }
 }
 
 CSError Board_push_change(struct Board * board, struct Tile * tile, int state)
 {
 // Push this action onto the undo stack
-        struct UndoAction * action = malloc(sizeof(struct UndoAction));
+        struct UndoAction * action = PoolSet_alloc(board->pool, sizeof(struct UndoAction));
         if (!action) { goto bad_alloc1; }
 
         *action = (struct UndoAction){.tile = tile, .old_type = tile->type, .new_type = state};
 
-        LNode_prepend((struct LNode **)&board->undo_stack, action, -1);
+        if (FAIL_ALLOC == LNode_prepend_pool(board->pool, (struct LNode **)&board->undo_stack, action, -1)) {
+                goto bad_alloc2;
+        }
 
         Board_set_tile(board, tile, state);
         return NO_FAILURE;
+bad_alloc2:
+        PoolSet_free(board->pool, action, sizeof(struct UndoAction));
 bad_alloc1:
         return FAIL_ALLOC;
 }
 void Board_pop_change(struct Board * board)
 {
-        struct UndoAction * action = LNode_pop((struct LNode **)&board->undo_stack);
+        struct UndoAction * action = LNode_pop_pool(board->pool, (struct LNode **)&board->undo_stack);
         if (!action) {
                 return;
         }
 
         Board_set_tile(board, action->tile, action->old_type);
-        free(action);
+        PoolSet_free(board->pool, action, sizeof(struct UndoAction));
 }
 
 int Board_click(struct Board * board, int x, int y, int button)
@@ -759,6 +1633,61 @@ int Board_is_solved(struct Board * board)
         return (Board_get_mistake(board) == -1) && (Board_pdata(board)->n_empty == 0);
 }
 
+void Board_get_memory_usage(struct Board * board, size_t * bytes, size_t * objects)
+{
+        size_t p_bytes = 0, p_objects = 0;
+        struct PoolSet * pool = board->pool;
+        if (board->private) {
+                Problem_get_memory_usage(Board_pdata(board)->problem, &p_bytes, &p_objects);
+                if (Board_pdata(board)->bitboard) {
+                        p_bytes += sizeof(struct EasySolver);
+                        p_objects++;
+                }
+        }
+        if (bytes) {
+                *bytes = pool->n_bytes + p_bytes;
+        }
+        if (objects) {
+                *objects = pool->n_objects + p_objects;
+        }
+}
+
+int Board_get_stats(struct Board * board, struct ProblemStats * stats)
+{
+        struct ProblemData * pdata = Board_pdata(board);
+        if (!pdata || !pdata->problem) {
+                *stats = (struct ProblemStats){.peak_DAG_nodes = 0};
+                return FAIL_PARAM;
+        }
+        CSError fail = Problem_get_stats(pdata->problem, stats);
+        // Mid-reduction, the parallel workers' copies count too
+        for (unsigned k = 1; pdata->pool && k < pdata->pool->n_workers; k++) {
+                struct ProblemStats s;
+                Problem_get_stats(pdata->pool->workers[k].pdata->problem, &s);
+                ProblemStats_add(stats, &s);
+        }
+        return fail;
+}
+
+// Traces the board's problem, see simple_solver/Trace.h. The copies
+// REDUCE_PARALLEL works on and the bitboard engine are not traced.
+int Board_trace_start(struct Board * board, FILE * out, unsigned tag)
+{
+        struct ProblemData * pdata = Board_pdata(board);
+        if (!pdata || !pdata->problem) {
+                return FAIL_PARAM;
+        }
+        return Problem_trace_start(pdata->problem, out, tag, BOARD_TRACE_CAPACITY);
+}
+int Board_trace_stop(struct Board * board)
+{
+        struct ProblemData * pdata = Board_pdata(board);
+        if (!pdata || !pdata->problem) {
+                return FAIL_PARAM;
+        }
+        return Problem_trace_stop(pdata->problem);
+}
+
 void Board_print(struct Board * board)
 {
         printf("??? %u %u\n", board->width, board->height);
@@ -881,7 +1810,7 @@ struct Board * Board_read(unsigned * n_seconds)
         for (unsigned i = 0; i < board->length; i++) {
                 if ((tiles[i].min_type == FILLED && tiles[i].max_type == WALL) ||
                     (tiles[i].min_type == WALL && tiles[i].max_type == NUMBER)) {
-                        LNode_prepend(&Board_pdata(board)->mistakes, Board_get_tile(board, i), i);
+                        LNode_prepend_pool(board->pool, &Board_pdata(board)->mistakes, Board_get_tile(board, i), i);
                 }
         }
 
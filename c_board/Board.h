@@ -1,3 +1,10 @@
+#ifndef BOARD_H
+#define BOARD_H
+#include <stddef.h>
+#include <stdio.h>
+
+#include "Rng.h"
+
 typedef struct { int x; int y; } Vector;
 typedef enum { EMPTY = -3, WALL = -2, FILLED = -1, NUMBER = 0} Type;
 typedef enum { NO_DIRECTION = -1, UP = 0, DOWN = 1, LEFT = 2, RIGHT = 3} Direction;
@@ -7,7 +14,6 @@ struct Tile {
         int id;
         int value;
         Type type;
-        struct Tile * dir[4];
 };
 
 struct Grid {
@@ -31,15 +37,29 @@ struct Board {
 
         void * undo_stack;
         void * private;
+        void * pool;      /**< Allocator for undo actions and the list of mistakes. */
+
+        unsigned   seed;  /**< What rng started from. The same seed, size, max tile
+                               and difficulty give the same puzzle anywhere. */
+        struct Rng rng;   /**< All of the board's randomness: maxify and the order givens are removed in. */
 };
 
+struct ProblemStats;
+
 int tile2int(struct Tile * t);
 void int2tile(Type i, struct Tile * t);
 
+// Board_create() picks a seed of its own, different for each board.
+// Both return NULL when width + height is over 257.
 struct Board * Board_create(      unsigned       width, unsigned height);
+struct Board * Board_create_seeded(unsigned      width, unsigned height, unsigned seed);
 unsigned       Board_maxify(      struct Board * board, unsigned max_tile);
 void           Board_init_problem(struct Board * board, int      difficulty);
 double         Board_reduce(      struct Board * board, unsigned batch_size);
+void           Board_set_reduce_mode(struct Board * board, int mode);
+void           Board_set_engine(  struct Board * board, int engine);
+void           Board_set_minimal( struct Board * board, int enabled);
+void           Board_set_reduce_threads(struct Board * board, unsigned n_threads);
 void           Board_destroy(     struct Board * board);
 
 int            Board_get_x(       struct Board * board, int index);
@@ -50,8 +70,20 @@ int            Board_click(       struct Board * board, int x, int y, int button
 struct Hint    Board_get_hint(    struct Board * board);
 int            Board_is_solved(   struct Board * board);
 void           Board_pop_change(  struct Board * board);
+void           Board_get_memory_usage(struct Board * board, size_t * bytes, size_t * objects);
+// Solver counters, see simple_solver/Problem.h. Not 0 if they are compiled out.
+int            Board_get_stats(   struct Board * board, struct ProblemStats * stats);
+// Propagation trace of the board's problem into out, see simple_solver/Trace.h.
+// Not 0 if tracing is compiled out. Destroying the board stops it too.
+int            Board_trace_start( struct Board * board, FILE * out, unsigned tag);
+int            Board_trace_stop(  struct Board * board);
 
 unsigned       Board_write(       struct Board * board, unsigned n_seconds);
 struct Board * Board_read(        unsigned     * n_seconds);
 
 void           Board_print(       struct Board * board);
+// Tiles in the exported encoding: 0 empty, 1 wall, 2 filled, 2 + n for the number n
+int            Board_get_full_tile(   struct Board * board, unsigned tile_i);
+int            Board_get_reduced_tile(struct Board * board, unsigned tile_i);
+
+#endif // BOARD_H
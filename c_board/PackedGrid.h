@@ -0,0 +1,96 @@
+#ifndef PACKED_GRID_H
+#define PACKED_GRID_H
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Board.h"
+#include "simple_solver/CSError.h"
+
+////////
+// PackedGrid
+////////
+// The grid the generator and the constraint builder work on: a type and a
+// value per tile in two byte arrays, row-major, framed by a border of PG_EDGE
+// cells. The neighbour of cell j in direction d is j + step[d], and a ray
+// ends where it reaches the border, so nothing is bounds-checked and
+// nothing is a pointer. struct Grid, with its Tiles, is the view the public
+// API hands out; PackedGrid_load() and PackedGrid_store() go between them.
+//
+// Cells are indexed with the border; tile ids without. Walking a ray
+// moves the cell by step[d] and the id by id_step[d].
+
+#define PG_EDGE ((int8_t)(EMPTY - 1)) /**< Type of a border cell: none of Type. */
+#define PG_MAX_VALUE UINT8_MAX        /**< A tile sees at most width + height - 2 others. */
+
+struct PackedGrid {
+        int       width, height;
+        int       length;     /**< width * height */
+        int       stride;     /**< width + 2 */
+        int       step[4];    /**< Cell offset to the next one in each Direction. */
+        int       id_step[4]; /**< Tile id offset likewise. */
+        int8_t  * type;       /**< Type, by cell. */
+        uint8_t * value;      /**< By cell. */
+};
+
+static inline CSError PackedGrid_init(struct PackedGrid * g, int width, int height)
+{
+        int stride = width + 2;
+        size_t n_cells = (size_t)stride * (height + 2);
+        *g = (struct PackedGrid){
+                .width   = width,
+                .height  = height,
+                .length  = width * height,
+                .stride  = stride,
+                .step    = {-stride, stride, -1, 1},
+                .id_step = {-width, width, -1, 1}};
+        g->type = malloc(2 * n_cells);
+        if (!g->type) {
+                goto bad_alloc1;
+        }
+        g->value = (uint8_t *)&g->type[n_cells];
+        for (size_t j = 0; j < n_cells; j++) {
+                g->type[j] = PG_EDGE;
+                g->value[j] = 0;
+        }
+        return NO_FAILURE;
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+static inline void PackedGrid_destroy(struct PackedGrid * g)
+{
+        free(g->type);
+        g->type = NULL;
+        g->value = NULL;
+}
+
+// Cell of tile id
+static inline int PackedGrid_cell(const struct PackedGrid * g, int id)
+{
+        return (id / g->width + 1) * g->stride + id % g->width + 1;
+}
+
+static inline void PackedGrid_load(struct PackedGrid * g, const struct Grid * grid)
+{
+        for (int y = 0, id = 0; y < g->height; y++) {
+                int j = (y + 1) * g->stride + 1;
+                for (int x = 0; x < g->width; x++, id++, j++) {
+                        const struct Tile * t = &grid->tiles[id];
+                        g->type[j] = (int8_t)t->type;
+                        g->value[j] = (uint8_t)(t->value > PG_MAX_VALUE ? PG_MAX_VALUE : t->value);
+                }
+        }
+}
+
+static inline void PackedGrid_store(const struct PackedGrid * g, struct Grid * grid)
+{
+        for (int y = 0, id = 0; y < g->height; y++) {
+                int j = (y + 1) * g->stride + 1;
+                for (int x = 0; x < g->width; x++, id++, j++) {
+                        grid->tiles[id].type = (Type)g->type[j];
+                        grid->tiles[id].value = g->value[j];
+                }
+        }
+}
+
+#endif // PACKED_GRID_H
@@ -0,0 +1,59 @@
+#ifndef RNG_H
+#define RNG_H
+#include <stdint.h>
+
+////////
+// Rng
+////////
+// xoshiro128**, seeded through splitmix64. Integer arithmetic only, so a
+// seed gives the same sequence on every platform and every compiler.
+
+struct Rng {
+        uint32_t s[4];
+};
+
+static inline void Rng_seed(struct Rng * rng, uint64_t seed)
+{
+        for (unsigned k = 0; k < 4; k += 2) {
+                uint64_t z = (seed += 0x9e3779b97f4a7c15u);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+                z ^= z >> 31;
+                rng->s[k]     = (uint32_t)z;
+                rng->s[k + 1] = (uint32_t)(z >> 32);
+        }
+}
+
+static inline uint32_t Rng_rotl(uint32_t x, unsigned k)
+{
+        return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t Rng_next(struct Rng * rng)
+{
+        uint32_t * s = rng->s;
+        uint32_t result = Rng_rotl(s[1] * 5, 7) * 9;
+        uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rng_rotl(s[3], 11);
+        return result;
+}
+
+// Uniform in [0, n), n > 0: Lemire's multiply, rejecting the biased low products
+static inline uint32_t Rng_below(struct Rng * rng, uint32_t n)
+{
+        uint64_t m = (uint64_t)Rng_next(rng) * n;
+        if ((uint32_t)m < n) {
+                uint32_t threshold = (0u - n) % n;
+                while ((uint32_t)m < threshold) {
+                        m = (uint64_t)Rng_next(rng) * n;
+                }
+        }
+        return (uint32_t)(m >> 32);
+}
+
+#endif // RNG_H
@@ -0,0 +1,159 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "simple_solver/Problem.h"
+
+////////
+// Filter microbenchmarks
+////////
+// Each filter bench drives a sequence of constraint states through several
+// filters, and through a null filter first so the cost of setting up the
+// states can be taken off. Each gets the best of BENCH_RUNS runs. A run folds
+// the result and the restrictions of every call into a checksum; all the
+// filters must agree with the first, which is the reference: the filter as
+// it was before the rewrite under test.
+
+#define BENCH_RUNS 3
+
+typedef CSError (* BenchFilter)(struct Constraint * c, struct LNode ** restrictions_return);
+typedef CSError (* BenchBatchFilter)(struct Constraint ** cs, unsigned n, struct LNode ** restrictions_return);
+
+// One of the filters a bench compares
+struct BenchCase {
+        const char       * name;
+        BenchFilter        filter; /**< Called on each constraint, unless batch is set. */
+        BenchBatchFilter   batch;  /**< Called on each group of constraints. */
+};
+
+// The sequence of states, the same for every case
+struct Bench {
+        struct Problem * p;
+        unsigned         n_calls; /**< Constraints filtered per run. */
+        unsigned         group;   /**< Constraints set up at a time, at most C_BATCH_MAX. */
+        void                 (* restart)(void);    /**< Back to the first state; may be NULL. */
+        struct Constraint ** (* next)(unsigned i); /**< Sets up group i and returns its constraints. */
+};
+
+static inline double Bench_now(void)
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Measures the cost of everything but the filter
+static inline CSError Bench_null_filter(struct Constraint * c, struct LNode ** restrictions_return)
+{
+        (void)c;
+        (void)restrictions_return;
+        return NO_FAILURE;
+}
+
+// Random non-empty subset of full
+static inline bitset Bench_random_narrowing(bitset full)
+{
+        bitset d = 0;
+        while (!d) {
+                d = full & (bitset)rand();
+        }
+        return d;
+}
+
+// Folds one call's result and restrictions into checksum, and frees the restrictions
+static inline unsigned long Bench_fold(struct Problem * p, unsigned long checksum,
+                                       CSError fail, struct LNode ** restrictions)
+{
+        checksum = checksum * 31 + fail;
+        while (*restrictions) {
+                struct Restriction * r = LNode_pop_pool(&p->pool, restrictions);
+                checksum = checksum * 31 + r->var->id * 977 + r->domain;
+                Restriction_destroy(&p->pool, r);
+        }
+        return checksum;
+}
+
+// Runs one case through the whole sequence; returns its checksum
+static inline unsigned long Bench_run(const struct Bench * b, const struct BenchCase * bc, double * seconds)
+{
+        struct LNode * found[C_BATCH_MAX];
+        unsigned long checksum = 0;
+        assert(b->group <= C_BATCH_MAX && 0 == b->n_calls % b->group);
+        if (b->restart) {
+                b->restart();
+        }
+        double t = Bench_now();
+        for (unsigned i = 0; i < b->n_calls / b->group; i++) {
+                struct Constraint ** cs = b->next(i);
+                if (bc->batch) {
+                        CSError fail = bc->batch(cs, b->group, found);
+                        for (unsigned j = 0; j < b->group; j++) {
+                                checksum = Bench_fold(b->p, checksum, fail, &found[j]);
+                        }
+                } else {
+                        for (unsigned j = 0; j < b->group; j++) {
+                                found[j] = NULL;
+                                CSError fail = bc->filter(cs[j], &found[j]);
+                                checksum = Bench_fold(b->p, checksum, fail, &found[j]);
+                        }
+                }
+        }
+        *seconds = Bench_now() - t;
+        return checksum;
+}
+
+// Best time of BENCH_RUNS runs
+static inline unsigned long Bench_best(const struct Bench * b, const struct BenchCase * bc, double * seconds)
+{
+        unsigned long checksum = Bench_run(b, bc, seconds);
+        for (unsigned r = 1; r < BENCH_RUNS; r++) {
+                double t;
+                Bench_run(b, bc, &t);
+                *seconds = t < *seconds ? t : *seconds;
+        }
+        return checksum;
+}
+
+// Runs every case and prints its time per call, and its speedup over the
+// first; returns 1 if any case disagrees with the first
+static inline int Bench_compare(const struct Bench * b, const struct BenchCase * cases, unsigned n_cases)
+{
+        static const struct BenchCase null_case = {"null", Bench_null_filter, NULL};
+        double overhead, seconds, reference_seconds = 0;
+        unsigned long reference = 0;
+        int mismatch = 0;
+
+        Bench_best(b, &null_case, &overhead);
+        for (unsigned k = 0; k < n_cases; k++) {
+                unsigned long checksum = Bench_best(b, &cases[k], &seconds);
+                seconds -= overhead;
+                printf("%-10s %6.1f ns/call", cases[k].name, 1e9 * seconds / b->n_calls);
+                if (0 == k) {
+                        reference = checksum;
+                        reference_seconds = seconds;
+                        printf("\n");
+                        continue;
+                }
+                printf(" (%.2fx)\n", reference_seconds / seconds);
+                if (checksum != reference) {
+                        printf("MISMATCH: %s disagrees with %s\n", cases[k].name, cases[0].name);
+                        mismatch = 1;
+                }
+        }
+        return mismatch;
+}
+
+////////
+// Reference filters
+////////
+// The filters as they were before the rewrites the benches measure, ported
+// only as far as the current Constraint layout needs. Defined in reference.c.
+
+CSError ConstraintSum_filter_reference(struct Constraint * c, struct LNode ** restrictions_return);
+CSError ConstraintVisibility_filter_reference(struct Constraint * c, struct LNode ** restrictions_return);
+CSError ConstraintTile_filter_reference(struct Constraint * c, struct LNode ** restrictions_return);
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ * Reference filters for the filter benches (see Bench.h).
+ *
+ * Each is the filter from the baseline tree's simple_solver/Constraint.h,
+ * as it stood before the commit named above it. The only changes are the
+ * ones the current Constraint needs: domains are read with C_domain(), and
+ * restrictions come from and go back to the constraint's pool. Keep them
+ * that way; a bench only means something if its reference does not move.
+ */
+#include <assert.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+
+// ConstraintSum_filter before 070a372 ("Make ConstraintSum_filter
+// allocation-free and word-parallel"): malloc'd f and g, and a test per bit
+CSError ConstraintSum_filter_reference(struct Constraint * c, struct LNode ** restrictions_return)
+{
+        unsigned fail = 0;
+        unsigned N = c->n_vars;
+
+        bitset * f = malloc((N+1) * sizeof(bitset));
+        if (!f) {
+                fail = FAIL_ALLOC;
+                goto bad_alloc1;
+        }
+        bitset * g = malloc((N+1) * sizeof(bitset));
+        if (!g) {
+                fail = FAIL_ALLOC;
+                goto bad_alloc2;
+        }
+
+        for (unsigned i = 0; i <= N; i++) {
+                f[i] = 0;
+                g[i] = 0;
+        }
+        f[0] = 1<<0;
+        for (unsigned i = 1; i <= N; i++) {
+                for (unsigned b = 0; b < DOMAIN_SIZE; b++) {
+                        if (f[i-1] & (1 << b)) {
+                                f[i] |= C_domain(c, i-1) << b;
+                        }
+                }
+        }
+
+        g[N] = f[N] & c->sum_data.domain;
+        fail |= !g[N];
+        if (fail) {
+                fail = FAILURE;
+                goto cleanup;
+        }
+
+        for (int i = N-1; i >= 0; i--) {
+                for (unsigned b = 0; b < DOMAIN_SIZE; b++) {
+                        g[i] |= !!((C_domain(c, i) << b) & g[i+1]) << b;
+                }
+                g[i] &= f[i];
+        }
+        for (unsigned i = 0; i < N; i++) {
+                bitset reduced_domain = 0;
+                for (unsigned b = 0; b < DOMAIN_SIZE; b++) {
+                        reduced_domain |= ((C_domain(c, i) & 1<<b) && ((f[i] << b) & g[i+1])) << b;
+                }
+                if (C_domain(c, i) != reduced_domain) {
+                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, reduced_domain, restrictions_return)) {
+                                goto bad_alloc3;
+                        }
+                }
+        }
+
+        goto cleanup;
+bad_alloc3:
+        Restriction_list_destroy(c->pool, restrictions_return);
+cleanup:
+bad_alloc2:
+        free(g);
+bad_alloc1:
+        free(f);
+        return fail;
+}
+
+// ConstraintVisibility_filter before e3e9875 ("Branch-free
+// ConstraintVisibility_filter and a batch filter API"): a loop per bit
+CSError ConstraintVisibility_filter_reference(struct Constraint * c, struct LNode ** restrictions_return)
+{
+        unsigned n_lhs = c->n_vars - 1; // Cardinality var
+        unsigned rhs_i = c->n_vars - 1; // Index var
+
+        bitset R = 0;
+        bitset B = 0;
+        bitset y = 0;
+        y = C_domain(c, rhs_i);
+        for (unsigned b = 0; b < n_lhs; b++) {
+                unsigned isred =  !!HAS_RED(C_domain(c, b));
+                R |= isred << b;
+                unsigned isblue = !!HAS_BLUE(C_domain(c, b));
+                B |= isblue << b;
+        }
+
+        unsigned blue_fixed = (B & ~R);
+        unsigned red_fixed = (R & ~B);
+        unsigned maxx = 0,
+                 maxy = 0,
+                 miny = 0;
+        for (unsigned b = 0; b < n_lhs; b++) {
+                if (!maxx && red_fixed & 1<<b) { maxx = 1<<b; }
+                if (y & 1<<b) { maxy = 1<<b; }
+                if (!miny && (y & 1<<b)) { miny = 1<<b; }
+        }
+        y = y & ~blue_fixed;
+        y = y & ((maxx<<1)-1);
+        R = R & ~(miny-1);
+        if (maxy == miny) {
+                B = B & ~y;
+        }
+
+        for (unsigned b = 0; b < n_lhs; b++) {
+                bitset reduced_domain = (!!(B & 1<<b) << BLUEBIT) | (!!(R & 1<<b) << REDBIT);
+                if (C_domain(c, b) != reduced_domain) {
+                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, b, reduced_domain, restrictions_return)) {
+                                goto bad_alloc1;
+                        }
+                }
+        }
+        if (C_domain(c, rhs_i) != y) {
+                if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, rhs_i, y, restrictions_return)) {
+                        goto bad_alloc1;
+                }
+        }
+        return NO_FAILURE;
+bad_alloc1:
+        Restriction_list_destroy(c->pool, restrictions_return);
+        return FAIL_ALLOC;
+}
+
+#define TILE_MAX_VARS 256 // A tile sees at most width + height - 2 others
+
+// ConstraintTile_filter before be64aa8 ("Make ConstraintTile_filter
+// single-pass with per-ray counts kept across calls"): a rescan of all four
+// rays per deduction
+CSError ConstraintTile_filter_reference(struct Constraint * c, struct LNode ** restrictions_return)
+{
+        // The baseline narrowed c->domains in place; domains now live in the vars
+        bitset domains[TILE_MAX_VARS];
+        assert(c->n_vars <= TILE_MAX_VARS);
+        for (unsigned i = 0; i < c->n_vars; i++) {
+                domains[i] = C_domain(c, i);
+        }
+        int modified;
+        do {
+                modified = 0;
+                unsigned n_blue = 0;
+                int FED_i[4] = {-1, -1, -1, -1};
+                unsigned n_empty[4] = {0,0,0,0};
+                unsigned add_one_yield[4] = {0,0,0,0};
+                unsigned how_many_directions = 0;
+                int only_direction = -1;
+
+                for (int d = 0; d < 4; d++) {
+                        for (unsigned i = (d ? c->tile_data.dir_n[d-1] : 0);
+                             i < c->tile_data.dir_n[d];
+                             i++) {
+                                bitset domain = domains[i];
+                                if (domain == (RED | BLUE)) {
+                                        if (0 == n_empty[d]) {
+                                                FED_i[d] = i;
+                                                add_one_yield[d]++;
+                                                how_many_directions++;
+                                                only_direction = d;
+                                        }
+                                        n_empty[d]++;
+                                } else if (domain == BLUE) {
+                                        if (0 == n_empty[d]) {
+                                                n_blue++;
+                                        } else if (1 == n_empty[d]) {
+                                                add_one_yield[d]++;
+                                        }
+                                } else if (domain == RED) {
+                                        break;
+                                }
+                        }
+                }
+
+                if (n_blue == c->tile_data.target_value) {
+                        for (int d = 0; d < 4; d++) {
+                                int i = FED_i[d];
+                                if (i != -1) {
+                                        domains[i] = RED;
+                                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, RED, restrictions_return)) {
+                                                goto bad_alloc1;
+                                        }
+                                        modified = 1;
+                                        break;
+                                }
+                        }
+                } else if (how_many_directions == 1) {
+                        int i = FED_i[only_direction];
+                        domains[i] = BLUE;
+                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, BLUE, restrictions_return)) {
+                                goto bad_alloc1;
+                        }
+                        modified = 1;
+                        break;
+                } else {
+                        for (int d = 0; d < 4; d++) {
+                                if (add_one_yield[d] + n_blue > c->tile_data.target_value) {
+                                        int i = FED_i[d];
+                                        domains[i] = RED;
+                                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, RED, restrictions_return)) {
+                                                goto bad_alloc1;
+                                        }
+                                        modified = 1;
+                                        break;
+                                }
+                        }
+                }
+        } while (modified);
+        return NO_FAILURE;
+bad_alloc1:
+        Restriction_list_destroy(c->pool, restrictions_return);
+        return FAIL_ALLOC;
+}
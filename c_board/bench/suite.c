@@ -0,0 +1,239 @@
+/*
+ * Benchmark suite: board generation and solving, stage by stage.
+ *
+ *   cmake -S . -B build && cmake --build build --target bench_suite
+ *   build/bench_suite [--boards N] [--seed S] [--min-size A] [--max-size B] [--out FILE]
+ *                     [--trace FILE]
+ *
+ * For each size from A x A to B x B (4 to 12 by default), in EASY and HARD,
+ * makes N boards from fixed seeds and times:
+ *   maxify        Board_maxify(), on a board from Board_create_seeded()
+ *   pdata_create  Board_init_problem()
+ *   reduce        Board_reduce() until done, in batches of one row
+ *   hint          Board_get_hint(), per call, solving the puzzle hint by hint
+ * Results go out as JSON. Each configuration carries a checksum of its
+ * puzzles, so a change of output shows up next to a change of speed.
+ * If the solver counters are compiled in (see CS_STATS), their totals over
+ * generating and solving go out too, as "stats".
+ * --trace writes a propagation trace of reducing and solving each board,
+ * if tracing is compiled in (see simple_solver/Trace.h), tagged
+ * size * 10000 + difficulty * 1000 + board. It slows those stages down.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Board.h"
+#include "simple_solver/Problem.h"
+
+#define MAX_BOARDS 1000
+
+enum Stage {STAGE_MAXIFY, STAGE_PDATA_CREATE, STAGE_REDUCE, STAGE_HINT, N_STAGES};
+static const char * stage_names[N_STAGES] = {"maxify", "pdata_create", "reduce", "hint"};
+
+struct Options {
+        unsigned     n_boards;
+        unsigned     seed;
+        unsigned     min_size;
+        unsigned     max_size;
+        const char * out;
+        FILE       * trace;
+};
+
+static double now(void)
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void * a, const void * b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+// Plays the hints until the board is solved; returns how many it took
+static unsigned solve_with_hints(struct Board * board, double * seconds)
+{
+        unsigned n_hints = 0;
+        *seconds = 0;
+        while (!Board_is_solved(board)) {
+                double start = now();
+                struct Hint hint = Board_get_hint(board);
+                *seconds += now() - start;
+                if (!hint.tile) {
+                        break;
+                }
+                n_hints++;
+                // Left click makes a tile blue, right click makes it red
+                int button = (WALL == hint.type) ? 0 : 1;
+                Board_click(board, Board_get_x(board, hint.id), Board_get_y(board, hint.id), button);
+        }
+        return n_hints;
+}
+
+static void print_stage(FILE * f, const char * name, double * samples, unsigned n)
+{
+        double total = 0;
+        for (unsigned k = 0; k < n; k++) {
+                total += samples[k];
+        }
+        qsort(samples, n, sizeof(double), compare_doubles);
+        fprintf(f, "\"%s\": {\"median_us\": %.3f, \"mean_us\": %.3f, \"max_us\": %.3f}",
+                name, 1e6 * samples[n / 2], 1e6 * total / n, 1e6 * samples[n - 1]);
+}
+
+static void print_stats(FILE * f, const struct ProblemStats * s)
+{
+        fprintf(f, "\"stats\": {\"filter_calls\": {\"tile\": %llu, \"sum\": %llu, \"visibility\": %llu}, "
+                   "\"filter_quiet\": %llu, \"restrictions_created\": %llu, \"restrictions_redundant\": %llu, "
+                   "\"restrictions_retracted\": %llu, \"peak_DAG_nodes\": %llu, \"queue_inserts\": %llu, "
+                   "\"queue_duplicates\": %llu, \"infeasible\": %llu}",
+                (unsigned long long)s->filter_calls[C_TILE], (unsigned long long)s->filter_calls[C_SUM],
+                (unsigned long long)s->filter_calls[C_VISIBILITY], (unsigned long long)s->filter_quiet,
+                (unsigned long long)s->restrictions_created, (unsigned long long)s->restrictions_redundant,
+                (unsigned long long)s->restrictions_retracted, (unsigned long long)s->peak_DAG_nodes,
+                (unsigned long long)s->queue_inserts, (unsigned long long)s->queue_duplicates,
+                (unsigned long long)s->infeasible);
+}
+
+static void run_config(FILE * f, const struct Options * opt, unsigned size, int difficulty)
+{
+        static double samples[N_STAGES][MAX_BOARDS];
+        unsigned checksum = 0;
+        unsigned n_givens = 0;
+        unsigned n_hints = 0;
+        unsigned n_hint_calls = 0;
+        unsigned n_unsolved = 0;
+        struct ProblemStats stats = {.peak_DAG_nodes = 0};
+        int has_stats = 1;
+
+        for (unsigned k = 0; k < opt->n_boards; k++) {
+                struct Board * board = Board_create_seeded(size, size, opt->seed + k);
+                if (!board) {
+                        fprintf(stderr, "out of memory\n");
+                        exit(EXIT_FAILURE);
+                }
+                double t0 = now();
+                Board_maxify(board, size < 9 ? size : 9);
+                double t1 = now();
+                Board_init_problem(board, difficulty);
+                if (opt->trace && Board_trace_start(board, opt->trace, size * 10000 + difficulty * 1000 + k)) {
+                        fprintf(stderr, "tracing is not compiled in, see simple_solver/Trace.h\n");
+                        exit(EXIT_FAILURE);
+                }
+                double t2 = now();
+                while (Board_reduce(board, size) != 1.) {
+                }
+                double t3 = now();
+
+                samples[STAGE_MAXIFY][k] = t1 - t0;
+                samples[STAGE_PDATA_CREATE][k] = t2 - t1;
+                samples[STAGE_REDUCE][k] = t3 - t2;
+                for (unsigned i = 0; i < board->length; i++) {
+                        int tile = Board_get_reduced_tile(board, i);
+                        checksum = checksum * 31 + (unsigned)tile;
+                        n_givens += (0 != tile);
+                }
+
+                double seconds;
+                unsigned hints = solve_with_hints(board, &seconds);
+                samples[STAGE_HINT][k] = hints ? seconds / hints : 0;
+                n_hints += hints;
+                n_hint_calls++;
+                n_unsolved += !Board_is_solved(board);
+                struct ProblemStats s;
+                has_stats = has_stats && (0 == Board_get_stats(board, &s));
+                ProblemStats_add(&stats, &s);
+                if (opt->trace) {
+                        Board_trace_stop(board);
+                }
+                Board_destroy(board);
+        }
+
+        fprintf(f, "    {\"size\": %u, \"difficulty\": \"%s\", \"boards\": %u, \"checksum\": \"%08x\", "
+                   "\"givens_per_board\": %.2f, \"hints_per_board\": %.2f, \"unsolved\": %u,\n     ",
+                size, difficulty ? "hard" : "easy", opt->n_boards, checksum,
+                (double)n_givens / opt->n_boards, (double)n_hints / n_hint_calls, n_unsolved);
+        for (unsigned s = 0; s < N_STAGES; s++) {
+                print_stage(f, stage_names[s], samples[s], opt->n_boards);
+                fprintf(f, (s + 1 < N_STAGES || has_stats) ? ",\n     " : "}");
+        }
+        if (has_stats) {
+                print_stats(f, &stats);
+                fprintf(f, "}");
+        }
+}
+
+static int parse_options(int argc, char ** argv, struct Options * opt)
+{
+        *opt = (struct Options){.n_boards = 20, .seed = 1, .min_size = 4, .max_size = 12,
+                                .out = NULL, .trace = NULL};
+        for (int i = 1; i < argc; i++) {
+                const char * value = (i + 1 < argc) ? argv[i + 1] : NULL;
+                if (!value) {
+                        return -1;
+                } else if (0 == strcmp(argv[i], "--boards")) {
+                        opt->n_boards = atoi(value);
+                } else if (0 == strcmp(argv[i], "--seed")) {
+                        opt->seed = atoi(value);
+                } else if (0 == strcmp(argv[i], "--min-size")) {
+                        opt->min_size = atoi(value);
+                } else if (0 == strcmp(argv[i], "--max-size")) {
+                        opt->max_size = atoi(value);
+                } else if (0 == strcmp(argv[i], "--out")) {
+                        opt->out = value;
+                } else if (0 == strcmp(argv[i], "--trace")) {
+                        opt->trace = fopen(value, "wb");
+                        if (!opt->trace) {
+                                perror(value);
+                                return -1;
+                        }
+                } else {
+                        return -1;
+                }
+                i++;
+        }
+        if (opt->n_boards < 1 || opt->n_boards > MAX_BOARDS || opt->min_size < 2 ||
+            opt->min_size > opt->max_size) {
+                return -1;
+        }
+        return 0;
+}
+
+int main(int argc, char ** argv)
+{
+        struct Options opt;
+        if (parse_options(argc, argv, &opt)) {
+                fprintf(stderr, "usage: %s [--boards N] [--seed S] [--min-size A] [--max-size B] [--out FILE]"
+                                " [--trace FILE]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        FILE * f = opt.out ? fopen(opt.out, "w") : stdout;
+        if (!f) {
+                perror(opt.out);
+                return EXIT_FAILURE;
+        }
+
+        fprintf(f, "{\n  \"benchmark\": \"generate\",\n  \"boards_per_config\": %u,\n  \"seed\": %u,\n"
+                   "  \"results\": [\n", opt.n_boards, opt.seed);
+        for (unsigned size = opt.min_size; size <= opt.max_size; size++) {
+                for (int difficulty = 0; difficulty < 2; difficulty++) {
+                        run_config(f, &opt, size, difficulty);
+                        int last = (size == opt.max_size && 1 == difficulty);
+                        fprintf(f, last ? "\n" : ",\n");
+                }
+        }
+        fprintf(f, "  ]\n}\n");
+
+        if (opt.out) {
+                fclose(f);
+        }
+        if (opt.trace) {
+                fclose(opt.trace);
+        }
+        return EXIT_SUCCESS;
+}
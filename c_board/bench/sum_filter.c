@@ -0,0 +1,63 @@
+/*
+ * Microbenchmark: ConstraintSum_filter against the bit-by-bit version it replaced.
+ *
+ *   cc -std=gnu11 -O2 -DNDEBUG -Ic_board c_board/bench/sum_filter.c c_board/bench/reference.c \
+ *      c_board/simple_solver/Problem.c -o sum_filter && ./sum_filter
+ *
+ * The constraints look like the HARD model's: one Sum per numbered tile,
+ * whose (up to four) addends are the tile's visibility counts, and whose
+ * domain is the tile's number. Addend domains are random narrowings of
+ * the full count domains, as seen in the middle of propagation.
+ */
+#include "Bench.h"
+
+#define N_CONSTRAINTS 512
+#define N_STATES      64
+#define N_ROUNDS      200
+
+static struct Problem * p;
+static struct Constraint * sums[N_CONSTRAINTS];
+static bitset states[N_CONSTRAINTS][N_STATES][4];
+
+// Every constraint in state 0, then every one in state 1, and so on
+static struct Constraint ** next(unsigned i)
+{
+        unsigned k = i % N_CONSTRAINTS;
+        unsigned s = i / N_CONSTRAINTS % N_STATES;
+        struct Constraint * c = sums[k];
+        for (unsigned j = 0; j < c->n_vars; j++) {
+                P_set_domain(p, c->vars[j], states[k][s][j]);
+        }
+        return &sums[k];
+}
+
+int main()
+{
+        srand(42);
+        p = Problem_create();
+
+        for (unsigned k = 0; k < N_CONSTRAINTS; k++) {
+                unsigned target = 1 + rand() % 9;
+                unsigned n_addends = 1 + rand() % 4;
+                struct Var * addends[4];
+                for (unsigned i = 0; i < n_addends; i++) {
+                        unsigned width = 1 + rand() % (target + 1);
+                        addends[i] = Problem_create_vars(p, 1, width + 1);
+                        for (unsigned s = 0; s < N_STATES; s++) {
+                                states[k][s][i] = Bench_random_narrowing(addends[i]->domain);
+                        }
+                }
+                sums[k] = Problem_create_empty_constraints(p, 1);
+                ConstraintSum_init(sums[k], 1<<target, addends, n_addends);
+        }
+        Problem_create_registry(p);
+
+        struct Bench bench = {p, N_ROUNDS * N_STATES * N_CONSTRAINTS, 1, NULL, next};
+        struct BenchCase cases[] = {
+                {"reference", ConstraintSum_filter_reference, NULL},
+                {"filter",    ConstraintSum_filter,           NULL},
+        };
+        int mismatch = Bench_compare(&bench, cases, 2);
+        Problem_destroy(p);
+        return mismatch;
+}
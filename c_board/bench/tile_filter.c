@@ -0,0 +1,84 @@
+/*
+ * Microbenchmark: ConstraintTile_filter against the rescanning version it replaced.
+ *
+ *   cc -std=gnu11 -O2 -DNDEBUG -Ic_board c_board/bench/tile_filter.c c_board/bench/reference.c \
+ *      c_board/simple_solver/Problem.c -o tile_filter && ./tile_filter
+ *
+ * The constraints look like the EASY model's: a numbered tile that sees
+ * four rays of up to eight tiles. Each tile has a hidden colour, and the
+ * number is what the tile sees. Between two calls a few tiles are revealed
+ * or hidden again, the way propagation and retraction move the domains,
+ * so the filter's per-ray counts are exercised across calls.
+ */
+#include "Bench.h"
+
+#define N_CONSTRAINTS 512
+#define N_STEPS       200000
+#define MAX_RAY       8
+
+static struct Problem * p;
+static struct Constraint * tiles[N_CONSTRAINTS];
+static bitset colour[N_CONSTRAINTS][4 * MAX_RAY];
+
+// Every tile hidden, and the same random steps from there
+static void restart(void)
+{
+        srand(7);
+        for (unsigned k = 0; k < N_CONSTRAINTS; k++) {
+                for (unsigned i = 0; i < tiles[k]->n_vars; i++) {
+                        P_set_domain(p, tiles[k]->vars[i], RED | BLUE);
+                }
+        }
+}
+
+// Reveals or hides a few of a random constraint's tiles
+static struct Constraint ** next(unsigned i)
+{
+        (void)i;
+        unsigned k = rand() % N_CONSTRAINTS;
+        struct Constraint * c = tiles[k];
+        for (unsigned n = 0; n < 3; n++) {
+                unsigned j = rand() % c->n_vars;
+                P_set_domain(p, c->vars[j], rand() % 2 ? colour[k][j] : RED | BLUE);
+        }
+        return &tiles[k];
+}
+
+int main()
+{
+        srand(42);
+        p = Problem_create();
+
+        for (unsigned k = 0; k < N_CONSTRAINTS; k++) {
+                unsigned how_many[4];
+                unsigned target = 0;
+                unsigned n = 0;
+                for (int d = 0; d < 4; d++) {
+                        how_many[d] = rand() % (MAX_RAY + 1);
+                        unsigned visible = 1;
+                        for (unsigned i = n; i < n + how_many[d]; i++) {
+                                colour[k][i] = rand() % 3 ? BLUE : RED;
+                                visible &= colour[k][i] == BLUE;
+                                target += visible;
+                        }
+                        n += how_many[d];
+                }
+                struct Var * vars = Problem_create_vars(p, n ? n : 1, 2);
+                struct Var * ray[4 * MAX_RAY];
+                for (unsigned i = 0; i < n; i++) {
+                        ray[i] = &vars[i];
+                }
+                tiles[k] = Problem_create_empty_constraints(p, 1);
+                ConstraintTile_init(tiles[k], target, ray, how_many);
+        }
+        Problem_create_registry(p);
+
+        struct Bench bench = {p, N_STEPS, 1, restart, next};
+        struct BenchCase cases[] = {
+                {"reference", ConstraintTile_filter_reference, NULL},
+                {"filter",    ConstraintTile_filter,           NULL},
+        };
+        int mismatch = Bench_compare(&bench, cases, 2);
+        Problem_destroy(p);
+        return mismatch;
+}
@@ -0,0 +1,71 @@
+/*
+ * Microbenchmark: ConstraintVisibility_filter and ConstraintVisibility_filter_batch
+ * against the per-bit-loop version they replaced.
+ *
+ *   cc -std=gnu11 -O2 -DNDEBUG -Ic_board c_board/bench/visibility_filter.c c_board/bench/reference.c \
+ *      c_board/simple_solver/Problem.c -o visibility_filter && ./visibility_filter
+ *
+ * The constraints look like the HARD model's: a ray of up to eight tiles
+ * ending in a fixed red, and a count of how many of them are visible.
+ * Tile and count domains are random narrowings, as seen in the middle of
+ * propagation. Each state is filtered by the three versions in turn; the
+ * batched one takes C_BATCH_MAX constraints at a time.
+ */
+#include "Bench.h"
+
+#define N_CONSTRAINTS 512
+#define N_STATES      64
+#define N_ROUNDS      200
+#define MAX_RAY       9
+
+static struct Problem * p;
+static struct Constraint * cs[N_CONSTRAINTS];
+static bitset states[N_CONSTRAINTS][N_STATES][MAX_RAY + 1];
+
+// C_BATCH_MAX constraints at a time, each group in state 0, then in state 1, and so on
+static struct Constraint ** next(unsigned i)
+{
+        unsigned first = i * C_BATCH_MAX % N_CONSTRAINTS;
+        unsigned s = i * C_BATCH_MAX / N_CONSTRAINTS % N_STATES;
+        for (unsigned k = first; k < first + C_BATCH_MAX; k++) {
+                for (unsigned j = 0; j < cs[k]->n_vars; j++) {
+                        P_set_domain(p, cs[k]->vars[j], states[k][s][j]);
+                }
+        }
+        return &cs[first];
+}
+
+int main()
+{
+        srand(42);
+        p = Problem_create();
+
+        for (unsigned k = 0; k < N_CONSTRAINTS; k++) {
+                unsigned n_lhs = 2 + rand() % (MAX_RAY - 1);
+                struct Var * tiles[MAX_RAY];
+                for (unsigned i = 0; i < n_lhs; i++) {
+                        tiles[i] = Problem_create_vars(p, 1, 2);
+                }
+                struct Var * count = Problem_create_vars(p, 1, n_lhs);
+                for (unsigned s = 0; s < N_STATES; s++) {
+                        for (unsigned i = 0; i < n_lhs - 1; i++) {
+                                states[k][s][i] = Bench_random_narrowing(RED | BLUE);
+                        }
+                        states[k][s][n_lhs - 1] = RED;
+                        states[k][s][n_lhs] = Bench_random_narrowing(count->domain);
+                }
+                cs[k] = Problem_create_empty_constraints(p, 1);
+                ConstraintVisibility_init(cs[k], tiles, n_lhs, count);
+        }
+        Problem_create_registry(p);
+
+        struct Bench bench = {p, N_ROUNDS * N_STATES * N_CONSTRAINTS, C_BATCH_MAX, NULL, next};
+        struct BenchCase cases[] = {
+                {"reference", ConstraintVisibility_filter_reference, NULL},
+                {"filter",    ConstraintVisibility_filter,           NULL},
+                {"batch",     NULL, ConstraintVisibility_filter_batch},
+        };
+        int mismatch = Bench_compare(&bench, cases, 3);
+        Problem_destroy(p);
+        return mismatch;
+}
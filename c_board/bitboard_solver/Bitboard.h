@@ -0,0 +1,248 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+#include <stdint.h>
+
+////////
+// Bitboard
+////////
+// One bit per tile of a grid, row-major: tile (x, y) is bit y*width + x.
+// BB_WORDS words cover every grid up to 11x11, which is all the game deals
+// out; every extra word slows every operation down.
+
+#define BB_WORDS 2
+#define BB_MAX_TILES (64 * BB_WORDS)
+
+struct Bitboard {
+        uint64_t w[BB_WORDS];
+};
+
+static inline struct Bitboard BB_and(struct Bitboard a, struct Bitboard b)
+{
+        for (unsigned k = 0; k < BB_WORDS; k++) {
+                a.w[k] &= b.w[k];
+        }
+        return a;
+}
+static inline struct Bitboard BB_or(struct Bitboard a, struct Bitboard b)
+{
+        for (unsigned k = 0; k < BB_WORDS; k++) {
+                a.w[k] |= b.w[k];
+        }
+        return a;
+}
+static inline struct Bitboard BB_xor(struct Bitboard a, struct Bitboard b)
+{
+        for (unsigned k = 0; k < BB_WORDS; k++) {
+                a.w[k] ^= b.w[k];
+        }
+        return a;
+}
+// a & ~b
+static inline struct Bitboard BB_andnot(struct Bitboard a, struct Bitboard b)
+{
+        for (unsigned k = 0; k < BB_WORDS; k++) {
+                a.w[k] &= ~b.w[k];
+        }
+        return a;
+}
+static inline int BB_is_empty(struct Bitboard a)
+{
+        uint64_t any = 0;
+        for (unsigned k = 0; k < BB_WORDS; k++) {
+                any |= a.w[k];
+        }
+        return !any;
+}
+static inline struct Bitboard BB_empty()
+{
+        return (struct Bitboard){{0}};
+}
+static inline struct Bitboard BB_full()
+{
+        struct Bitboard a;
+        for (unsigned k = 0; k < BB_WORDS; k++) {
+                a.w[k] = ~(uint64_t)0;
+        }
+        return a;
+}
+static inline int BB_test(struct Bitboard a, unsigned i)
+{
+        return (a.w[i / 64] >> (i % 64)) & 1;
+}
+static inline void BB_set(struct Bitboard * a, unsigned i)
+{
+        a->w[i / 64] |= (uint64_t)1 << (i % 64);
+}
+static inline void BB_clear(struct Bitboard * a, unsigned i)
+{
+        a->w[i / 64] &= ~((uint64_t)1 << (i % 64));
+}
+// Index of the lowest set bit. a must not be empty.
+static inline unsigned BB_lowest(struct Bitboard a)
+{
+        unsigned k = 0;
+        while (!a.w[k]) {
+                k++;
+        }
+        return 64 * k + __builtin_ctzll(a.w[k]);
+}
+
+// Towards higher indices. 0 < n < 64.
+static inline struct Bitboard BB_shl(struct Bitboard a, unsigned n)
+{
+        for (unsigned k = BB_WORDS - 1; k > 0; k--) {
+                a.w[k] = a.w[k] << n | a.w[k-1] >> (64 - n);
+        }
+        a.w[0] <<= n;
+        return a;
+}
+// Towards lower indices. 0 < n < 64.
+static inline struct Bitboard BB_shr(struct Bitboard a, unsigned n)
+{
+        for (unsigned k = 0; k < BB_WORDS - 1; k++) {
+                a.w[k] = a.w[k] >> n | a.w[k+1] << (64 - n);
+        }
+        a.w[BB_WORDS - 1] >>= n;
+        return a;
+}
+
+////////
+// Geometry
+////////
+// Moving a whole bitboard one tile in a direction, dropping what falls off the grid.
+// The directions are numbered as in Board.h: UP, DOWN, LEFT, RIGHT.
+
+struct BBGeometry {
+        unsigned        width;
+        unsigned        height;
+        struct Bitboard all;            /**< Every tile of the grid. */
+        struct Bitboard not_first_col;
+        struct Bitboard not_last_col;
+};
+
+static inline void BBGeometry_init(struct BBGeometry * g, unsigned width, unsigned height)
+{
+        g->width = width;
+        g->height = height;
+        g->all = BB_empty();
+        g->not_first_col = BB_empty();
+        g->not_last_col = BB_empty();
+        for (unsigned i = 0; i < width * height; i++) {
+                BB_set(&g->all, i);
+                if (i % width != 0) {
+                        BB_set(&g->not_first_col, i);
+                }
+                if (i % width != width - 1) {
+                        BB_set(&g->not_last_col, i);
+                }
+        }
+}
+
+// Bit x of the result is bit (x - d) of a, on a grid width wide. A constant
+// width makes the vertical moves constant shifts.
+static inline struct Bitboard BB_step_in(const struct BBGeometry * g, unsigned width, struct Bitboard a, int d)
+{
+        switch (d) {
+        case 0: // UP
+                return BB_shr(a, width);
+        case 1: // DOWN
+                return BB_and(BB_shl(a, width), g->all);
+        case 2: // LEFT
+                return BB_and(BB_shr(a, 1), g->not_last_col);
+        default: // RIGHT
+                return BB_and(BB_shl(a, 1), g->not_first_col);
+        }
+}
+
+static inline struct Bitboard BB_step(const struct BBGeometry * g, struct Bitboard a, int d)
+{
+        return BB_step_in(g, g->width, a, d);
+}
+
+// Bit x of the result is bit (x + d) of a: what a tile sees one step towards d
+static inline struct Bitboard BB_look(const struct BBGeometry * g, struct Bitboard a, int d)
+{
+        return BB_step(g, a, d ^ 1);
+}
+
+static inline struct Bitboard BB_look_in(const struct BBGeometry * g, unsigned width, struct Bitboard a, int d)
+{
+        return BB_step_in(g, width, a, d ^ 1);
+}
+
+////////
+// Bit-sliced counters
+////////
+// A small unsigned number per tile, one bitboard per binary digit,
+// so that a whole grid of counters is added or compared at once.
+
+#define BB_COUNTER_BITS 6
+
+struct BBCounter {
+        struct Bitboard bit[BB_COUNTER_BITS];
+};
+
+static inline void BBCounter_zero(struct BBCounter * c)
+{
+        for (unsigned b = 0; b < BB_COUNTER_BITS; b++) {
+                c->bit[b] = BB_empty();
+        }
+}
+
+// Adds one where mask is set
+static inline void BBCounter_increment(struct BBCounter * c, struct Bitboard mask)
+{
+        for (unsigned b = 0; b < BB_COUNTER_BITS && !BB_is_empty(mask); b++) {
+                struct Bitboard carry = BB_and(c->bit[b], mask);
+                c->bit[b] = BB_xor(c->bit[b], mask);
+                mask = carry;
+        }
+}
+
+static inline void BBCounter_set(struct BBCounter * c, unsigned i, unsigned value)
+{
+        for (unsigned b = 0; b < BB_COUNTER_BITS; b++) {
+                if (value >> b & 1) {
+                        BB_set(&c->bit[b], i);
+                } else {
+                        BB_clear(&c->bit[b], i);
+                }
+        }
+}
+
+// Where a == b
+static inline struct Bitboard BBCounter_equal(const struct BBCounter * a, const struct BBCounter * b)
+{
+        struct Bitboard diff = BB_empty();
+        for (unsigned b_i = 0; b_i < BB_COUNTER_BITS; b_i++) {
+                diff = BB_or(diff, BB_xor(a->bit[b_i], b->bit[b_i]));
+        }
+        return BB_andnot(BB_full(), diff);
+}
+
+// Where a > b
+static inline struct Bitboard BBCounter_greater(const struct BBCounter * a, const struct BBCounter * b)
+{
+        struct Bitboard gt = BB_empty();
+        struct Bitboard eq = BB_full();
+        for (unsigned b_i = BB_COUNTER_BITS; b_i-- > 0;) {
+                gt = BB_or(gt, BB_and(eq, BB_andnot(a->bit[b_i], b->bit[b_i])));
+                eq = BB_andnot(eq, BB_xor(a->bit[b_i], b->bit[b_i]));
+        }
+        return gt;
+}
+
+// r = a - b where a >= b. Elsewhere r is garbage.
+static inline void BBCounter_subtract(struct BBCounter * r, const struct BBCounter * a, const struct BBCounter * b)
+{
+        struct Bitboard borrow = BB_empty();
+        for (unsigned b_i = 0; b_i < BB_COUNTER_BITS; b_i++) {
+                struct Bitboard x = a->bit[b_i];
+                struct Bitboard y = b->bit[b_i];
+                r->bit[b_i] = BB_xor(BB_xor(x, y), borrow);
+                // Borrow out when x < y + borrow_in
+                borrow = BB_or(BB_andnot(y, x), BB_andnot(borrow, BB_xor(x, y)));
+        }
+}
+
+#endif // BITBOARD_H
@@ -0,0 +1,256 @@
+#include <stdlib.h>
+
+#include "EasySolver.h"
+
+// Counts stay below 1 << BB_COUNTER_BITS as long as no side is longer than this
+#define EASY_MAX_SIDE 16
+
+static EasyRound EasySolver_pick_round(unsigned width, unsigned height);
+
+struct EasySolver * EasySolver_create(unsigned width, unsigned height)
+{
+        if (width == 0 || height == 0 || width > EASY_MAX_SIDE || height > EASY_MAX_SIDE
+            || width * height > BB_MAX_TILES) {
+                goto bad_param;
+        }
+        struct EasySolver * s = malloc(sizeof(struct EasySolver));
+        if (!s) {
+                goto bad_alloc1;
+        }
+        BBGeometry_init(&s->g, width, height);
+        s->round = EasySolver_pick_round(width, height);
+        s->given_red = s->g.all;
+        s->given_blue = s->g.all;
+        s->numbers = BB_empty();
+        BBCounter_zero(&s->target);
+        s->red = s->given_red;
+        s->blue = s->given_blue;
+        return s;
+bad_alloc1:
+bad_param:
+        return NULL;
+}
+
+void EasySolver_destroy(struct EasySolver * s)
+{
+        free(s);
+}
+
+void EasySolver_set_tile(struct EasySolver * s, unsigned index, bitset domain)
+{
+        if (HAS_RED(domain)) {
+                BB_set(&s->given_red, index);
+        } else {
+                BB_clear(&s->given_red, index);
+        }
+        if (HAS_BLUE(domain)) {
+                BB_set(&s->given_blue, index);
+        } else {
+                BB_clear(&s->given_blue, index);
+        }
+}
+
+void EasySolver_set_number(struct EasySolver * s, unsigned index, unsigned value)
+{
+        BB_set(&s->numbers, index);
+        BBCounter_set(&s->target, index, value);
+}
+
+void EasySolver_clear_number(struct EasySolver * s, unsigned index)
+{
+        BB_clear(&s->numbers, index);
+}
+
+// EasySolver_round_body() is compiled once more for each side in EASY_SIDES,
+// with the width a constant, and what it calls is inlined into each copy.
+#define EASY_INLINE static inline __attribute__((always_inline))
+
+// The first undecided tile along d of every tile in from, walking over fixed blues
+EASY_INLINE struct Bitboard EasySolver_fronts(const struct EasySolver * s, unsigned width, struct Bitboard from,
+                                              int d, struct Bitboard fixed_blue, struct Bitboard undecided)
+{
+        struct Bitboard hits = BB_empty();
+        if (BB_is_empty(from)) {
+                return hits;
+        }
+        struct Bitboard p = BB_step_in(&s->g, width, from, d);
+        while (!BB_is_empty(p)) {
+                hits = BB_or(hits, BB_and(p, undecided));
+                p = BB_step_in(&s->g, width, BB_and(p, fixed_blue), d);
+        }
+        return hits;
+}
+
+// One application of the ConstraintTile rules to the numbers in lanes.
+// Per number and direction it counts the blues before the first undecided
+// tile, and the yield of making that tile blue (itself and the blues right
+// behind it), walking all the rays one step at a time. Then:
+//   1. If enough blues are visible, every ray ends at its first undecided tile.
+//   2. If only one ray can still grow, its first undecided tile is blue.
+//   3. If growing a ray would see too many blues, its first undecided tile is red.
+// Also returns in done the numbers that no longer see an undecided tile:
+// they have nothing left to deduce, since domains only ever narrow.
+EASY_INLINE CSError EasySolver_round_body(const struct EasySolver * s, unsigned width, struct Bitboard red,
+                                          struct Bitboard blue, struct Bitboard lanes, struct Bitboard * to_red,
+                                          struct Bitboard * to_blue, struct Bitboard * done)
+{
+        struct Bitboard fixed_blue = BB_andnot(blue, red);
+        struct Bitboard undecided = BB_and(red, blue);
+        struct BBCounter n_blue;
+        struct BBCounter yield[4];
+        struct Bitboard open[4];
+
+        BBCounter_zero(&n_blue);
+        for (int d = 0; d < 4; d++) {
+                BBCounter_zero(&yield[d]);
+                open[d] = BB_empty();
+                // Lanes still walking: through the leading blues,
+                // or through the blues right after the first undecided tile
+                struct Bitboard in_prefix = lanes;
+                struct Bitboard after_open = BB_empty();
+                struct Bitboard just_opened = BB_empty();
+                // What each number sees k steps away, for k = 1, 2, ...
+                struct Bitboard fb = BB_look_in(&s->g, width, fixed_blue, d);
+                struct Bitboard und = BB_look_in(&s->g, width, undecided, d);
+                while (!BB_is_empty(BB_or(in_prefix, BB_or(after_open, just_opened)))) {
+                        struct Bitboard opened = BB_and(in_prefix, und);
+                        after_open = BB_and(BB_or(after_open, just_opened), fb);
+                        in_prefix = BB_and(in_prefix, fb);
+                        BBCounter_increment(&n_blue, in_prefix);
+                        BBCounter_increment(&yield[d], after_open);
+                        open[d] = BB_or(open[d], opened);
+                        just_opened = opened;
+                        fb = BB_look_in(&s->g, width, fb, d);
+                        und = BB_look_in(&s->g, width, und, d);
+                }
+                BBCounter_increment(&yield[d], open[d]);
+        }
+
+        if (!BB_is_empty(BB_and(lanes, BBCounter_greater(&n_blue, &s->target)))) {
+                goto infeasible;
+        }
+        struct Bitboard full = BB_and(lanes, BBCounter_equal(&n_blue, &s->target));
+        struct Bitboard rest = BB_andnot(lanes, full);
+        struct BBCounter slack;
+        BBCounter_subtract(&slack, &s->target, &n_blue);
+
+        // Numbers with exactly one open direction
+        struct Bitboard some_open = BB_empty();
+        struct Bitboard two_open = BB_empty();
+        for (int d = 0; d < 4; d++) {
+                two_open = BB_or(two_open, BB_and(some_open, open[d]));
+                some_open = BB_or(some_open, open[d]);
+        }
+        struct Bitboard single = BB_and(rest, BB_andnot(some_open, two_open));
+        *done = BB_andnot(lanes, some_open);
+
+        *to_red = BB_empty();
+        *to_blue = BB_empty();
+        for (int d = 0; d < 4; d++) {
+                /* 1 */ /* 3 */
+                struct Bitboard close = BB_and(rest, open[d]);
+                if (!BB_is_empty(close)) {
+                        close = BB_and(close, BBCounter_greater(&yield[d], &slack));
+                }
+                close = BB_or(close, full);
+                *to_red = BB_or(*to_red, EasySolver_fronts(s, width, close, d, fixed_blue, undecided));
+                /* 2 */
+                struct Bitboard grow = BB_and(single, open[d]);
+                *to_blue = BB_or(*to_blue, EasySolver_fronts(s, width, grow, d, fixed_blue, undecided));
+        }
+        if (!BB_is_empty(BB_and(*to_red, *to_blue))) {
+                goto infeasible;
+        }
+        return NO_FAILURE;
+infeasible:
+        return FAILURE;
+}
+
+// Every square board the engine covers; other shapes take EasySolver_round_any()
+#define EASY_SIDES(X) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11)
+
+#define EASY_SPECIALISE(side) \
+        static CSError EasySolver_round_##side(const struct EasySolver * s, struct Bitboard red, \
+                                               struct Bitboard blue, struct Bitboard lanes, \
+                                               struct Bitboard * to_red, struct Bitboard * to_blue, \
+                                               struct Bitboard * done) \
+        { \
+                return EasySolver_round_body(s, side, red, blue, lanes, to_red, to_blue, done); \
+        }
+EASY_SIDES(EASY_SPECIALISE)
+#undef EASY_SPECIALISE
+
+static CSError EasySolver_round_any(const struct EasySolver * s, struct Bitboard red, struct Bitboard blue,
+                                    struct Bitboard lanes, struct Bitboard * to_red, struct Bitboard * to_blue,
+                                    struct Bitboard * done)
+{
+        return EasySolver_round_body(s, s->g.width, red, blue, lanes, to_red, to_blue, done);
+}
+
+static EasyRound EasySolver_pick_round(unsigned width, unsigned height)
+{
+        if (width == height) {
+                switch (width) {
+#define EASY_CASE(side) \
+                case side: \
+                        return EasySolver_round_##side;
+                EASY_SIDES(EASY_CASE)
+#undef EASY_CASE
+                }
+        }
+        return EasySolver_round_any;
+}
+
+CSError EasySolver_solve(struct EasySolver * s)
+{
+        s->red = s->given_red;
+        s->blue = s->given_blue;
+        // Numbers that may still deduce something
+        struct Bitboard lanes = s->numbers;
+        for (;;) {
+                struct Bitboard to_red, to_blue, done;
+                if (FAILURE == s->round(s, s->red, s->blue, lanes, &to_red, &to_blue, &done)) {
+                        goto infeasible;
+                }
+                // Deductions only ever land on undecided tiles, so anything found is news
+                if (BB_is_empty(BB_or(to_red, to_blue))) {
+                        break;
+                }
+                lanes = BB_andnot(lanes, done);
+                s->blue = BB_andnot(s->blue, to_red);
+                s->red = BB_andnot(s->red, to_blue);
+        }
+        if (!BB_is_empty(BB_andnot(s->g.all, BB_or(s->red, s->blue)))) {
+                goto infeasible;
+        }
+        return NO_FAILURE;
+infeasible:
+        return FAILURE;
+}
+
+int EasySolver_is_unique(struct EasySolver * s)
+{
+        return BB_is_empty(BB_and(s->red, s->blue));
+}
+
+bitset EasySolver_domain(struct EasySolver * s, unsigned index)
+{
+        return (BB_test(s->red, index) ? RED : 0) | (BB_test(s->blue, index) ? BLUE : 0);
+}
+
+CSError EasySolver_find_deduction(struct EasySolver * s, unsigned * index, bitset * domain)
+{
+        struct Bitboard to_red, to_blue, done;
+        if (FAILURE == s->round(s, s->given_red, s->given_blue, s->numbers, &to_red, &to_blue, &done)) {
+                goto nothing;
+        }
+        struct Bitboard found = BB_or(to_red, to_blue);
+        if (BB_is_empty(found)) {
+                goto nothing;
+        }
+        *index = BB_lowest(found);
+        *domain = BB_test(to_red, *index) ? RED : BLUE;
+        return NO_FAILURE;
+nothing:
+        return FAILURE;
+}
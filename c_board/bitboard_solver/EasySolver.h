@@ -0,0 +1,47 @@
+#ifndef EASYSOLVER_H
+#define EASYSOLVER_H
+
+#include "Bitboard.h"
+#include "../simple_solver/Var.h"
+#include "../simple_solver/CSError.h"
+
+struct EasySolver;
+
+// One round of the rules, see EasySolver.c
+typedef CSError (*EasyRound)(const struct EasySolver * s, struct Bitboard red, struct Bitboard blue,
+                             struct Bitboard lanes, struct Bitboard * to_red, struct Bitboard * to_blue,
+                             struct Bitboard * done);
+
+// Propagates the EASY model (the rules of ConstraintTile) over a whole grid
+// at once. Every numbered tile is a lane of the same bitboard operations,
+// so a round costs the same for one number as for all of them.
+// Only fits grids of up to BB_MAX_TILES tiles, with no side longer than 16.
+struct EasySolver {
+        struct BBGeometry g;
+        struct Bitboard   given_red;  /**< Tiles the givens allow to be red. */
+        struct Bitboard   given_blue; /**< Tiles the givens allow to be blue. */
+        struct Bitboard   numbers;    /**< Numbered tiles whose constraint is active. */
+        struct BBCounter  target;     /**< Their values. */
+        struct Bitboard   red;        /**< After propagation: tiles that can still be red. */
+        struct Bitboard   blue;       /**< After propagation: tiles that can still be blue. */
+        EasyRound         round;      /**< Compiled for this size, if it is a standard one. */
+};
+
+struct EasySolver * EasySolver_create(unsigned width, unsigned height);
+void EasySolver_destroy(struct EasySolver * s);
+
+// A tile's given domain: RED, BLUE or RED | BLUE
+void EasySolver_set_tile(struct EasySolver * s, unsigned index, bitset domain);
+void EasySolver_set_number(struct EasySolver * s, unsigned index, unsigned value);
+void EasySolver_clear_number(struct EasySolver * s, unsigned index);
+
+// Propagates from the givens to a fixpoint. FAILURE if they contradict each other.
+CSError EasySolver_solve(struct EasySolver * s);
+// True if the last solve decided every tile
+int EasySolver_is_unique(struct EasySolver * s);
+bitset EasySolver_domain(struct EasySolver * s, unsigned index);
+// One round of the rules on the givens. FAILURE if it finds nothing,
+// otherwise the lowest tile it decided, and how.
+CSError EasySolver_find_deduction(struct EasySolver * s, unsigned * index, bitset * domain);
+
+#endif // EASYSOLVER_H
@@ -0,0 +1,106 @@
+/*
+ * Command line generator.
+ *
+ *   ohno [-s SIZES] [-d easy|hard|both] [-n COUNT] [-j THREADS] [--seed SEED]
+ *
+ * Makes COUNT boards for each size in the comma separated list SIZES and
+ * each difficulty, and prints one JSON object per board and per line:
+ *   {"size":6,"difficulty":"easy","index":0,"seed":...,"full":[...],"puzzle":[...]}
+ * Tiles are in the exported encoding: 0 empty, 1 wall, 2 filled, 2 + n for
+ * the number n. The same seed gives the same boards, and each board's own
+ * "seed" gives it again through Board_create_seeded(). A report goes to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Batch.h"
+
+#define MAX_JOBS 64
+
+static void print_board(void * ctx, const struct BatchJob * job, unsigned index,
+                        unsigned seed, struct Board * board)
+{
+        FILE * f = ctx;
+        fprintf(f, "{\"size\":%u,\"difficulty\":\"%s\",\"index\":%u,\"seed\":%u,\"full\":[",
+                job->size, job->difficulty ? "hard" : "easy", index, seed);
+        for (unsigned i = 0; i < board->length; i++) {
+                fprintf(f, i ? ",%i" : "%i", Board_get_full_tile(board, i));
+        }
+        fprintf(f, "],\"puzzle\":[");
+        for (unsigned i = 0; i < board->length; i++) {
+                fprintf(f, i ? ",%i" : "%i", Board_get_reduced_tile(board, i));
+        }
+        fprintf(f, "]}\n");
+}
+
+static void usage(const char * name)
+{
+        fprintf(stderr, "usage: %s [-s SIZES] [-d easy|hard|both] [-n COUNT] [-j THREADS] [--seed SEED]\n", name);
+}
+
+int main(int argc, char ** argv)
+{
+        const char * sizes = "6";
+        const char * difficulty = "easy";
+        unsigned count = 1;
+        unsigned n_threads = 1;
+        unsigned seed = (unsigned)time(0);
+
+        for (int i = 1; i < argc; i++) {
+                const char * value = (i + 1 < argc) ? argv[i + 1] : NULL;
+                if (!value) {
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                } else if (0 == strcmp(argv[i], "-s")) {
+                        sizes = value;
+                } else if (0 == strcmp(argv[i], "-d")) {
+                        difficulty = value;
+                } else if (0 == strcmp(argv[i], "-n")) {
+                        count = atoi(value);
+                } else if (0 == strcmp(argv[i], "-j")) {
+                        n_threads = atoi(value);
+                } else if (0 == strcmp(argv[i], "--seed")) {
+                        seed = strtoul(value, NULL, 0);
+                } else {
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                }
+                i++;
+        }
+
+        int easy = !strcmp(difficulty, "easy") || !strcmp(difficulty, "both");
+        int hard = !strcmp(difficulty, "hard") || !strcmp(difficulty, "both");
+        if (!easy && !hard) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        struct BatchJob jobs[MAX_JOBS];
+        unsigned n_jobs = 0;
+        for (const char * s = sizes; *s; ) {
+                char * end;
+                unsigned size = strtoul(s, &end, 10);
+                if (end == s || size < 2 || n_jobs + 2 > MAX_JOBS) {
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                }
+                if (easy) {
+                        jobs[n_jobs++] = (struct BatchJob){size, 0, count};
+                }
+                if (hard) {
+                        jobs[n_jobs++] = (struct BatchJob){size, 1, count};
+                }
+                s = (',' == *end) ? end + 1 : end;
+        }
+
+        struct BatchReport report = {0};
+        CSError fail = Batch_generate(jobs, n_jobs, n_threads, seed, print_board, stdout, &report);
+        if (report.threads) {
+                fprintf(stderr, "seed %u\n", seed);
+                BatchReport_print(stderr, &report);
+                BatchReport_destroy(&report);
+        }
+        return (NO_FAILURE == fail) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,189 @@
+/*
+ * Decoder for propagation traces, see simple_solver/Trace.h.
+ *
+ *   ohno-trace [-s] FILE
+ *
+ * Prints one event per line:
+ *   tag  time_us  event  details
+ * or, with -s, a summary per tag: how many drains of the queue, how long
+ * they took, and the filters, narrowings and retractions they went through.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simple_solver/Problem.h"
+
+static const char * kind_names[C_N_KINDS] = {"none", "tile", "sum", "visibility"};
+
+struct TagSummary {
+        uint32_t tag;
+        uint64_t drain_start;   // Of the drain under way
+        uint64_t n_drains;
+        uint64_t n_infeasible;
+        uint64_t drain_ns;
+        uint64_t max_drain_ns;
+        uint64_t n_filters[C_N_KINDS];
+        uint64_t n_quiet;
+        uint64_t n_narrowed;
+        uint64_t n_retracted;
+};
+
+struct Summary {
+        unsigned            n_tags;
+        unsigned            capacity;
+        struct TagSummary * tags;
+};
+
+static const char * kind_name(unsigned kind)
+{
+        return kind < C_N_KINDS ? kind_names[kind] : "?";
+}
+
+static void print_event(uint32_t tag, const struct TraceEvent * e)
+{
+        printf("%u %.3f ", tag, e->time * 1e-3);
+        switch (e->type) {
+        case TRACE_DRAIN_BEGIN:
+                printf("drain_begin queued=%u\n", e->value);
+                break;
+        case TRACE_DRAIN_END:
+                printf("drain_end %s\n", e->value ? "infeasible" : "ok");
+                break;
+        case TRACE_FILTER:
+                printf("filter c=%u %s%s\n", e->id, kind_name(e->kind), e->value ? " quiet" : "");
+                break;
+        case TRACE_NARROW:
+                printf("narrow v=%u domain=0x%x by c=%u %s\n", e->id, e->value, e->cause, kind_name(e->kind));
+                break;
+        case TRACE_RETRACT:
+                printf("retract v=%u domain=0x%x\n", e->id, e->value);
+                break;
+        default:
+                printf("unknown type=%u\n", e->type);
+                break;
+        }
+}
+
+static struct TagSummary * Summary_get(struct Summary * s, uint32_t tag)
+{
+        for (unsigned k = 0; k < s->n_tags; k++) {
+                if (s->tags[k].tag == tag) {
+                        return &s->tags[k];
+                }
+        }
+        if (s->n_tags == s->capacity) {
+                unsigned capacity = s->capacity ? 2 * s->capacity : 64;
+                struct TagSummary * tags = realloc(s->tags, capacity * sizeof(struct TagSummary));
+                if (!tags) {
+                        return NULL;
+                }
+                s->tags = tags;
+                s->capacity = capacity;
+        }
+        struct TagSummary * t = &s->tags[s->n_tags++];
+        *t = (struct TagSummary){.tag = tag};
+        return t;
+}
+
+static void Summary_add(struct TagSummary * t, const struct TraceEvent * e)
+{
+        switch (e->type) {
+        case TRACE_DRAIN_BEGIN:
+                t->drain_start = e->time;
+                break;
+        case TRACE_DRAIN_END: {
+                uint64_t ns = e->time - t->drain_start;
+                t->n_drains++;
+                t->n_infeasible += e->value;
+                t->drain_ns += ns;
+                t->max_drain_ns = ns > t->max_drain_ns ? ns : t->max_drain_ns;
+                break;
+        }
+        case TRACE_FILTER:
+                if (e->kind < C_N_KINDS) {
+                        t->n_filters[e->kind]++;
+                }
+                t->n_quiet += e->value;
+                break;
+        case TRACE_NARROW:
+                t->n_narrowed++;
+                break;
+        case TRACE_RETRACT:
+                t->n_retracted++;
+                break;
+        }
+}
+
+static void Summary_print(const struct Summary * s)
+{
+        printf("tag drains infeasible drain_us mean_drain_us max_drain_us");
+        for (unsigned k = 1; k < C_N_KINDS; k++) {
+                printf(" %s", kind_names[k]);
+        }
+        printf(" quiet narrowed retracted\n");
+        for (unsigned j = 0; j < s->n_tags; j++) {
+                const struct TagSummary * t = &s->tags[j];
+                printf("%u %llu %llu %.3f %.3f %.3f", t->tag,
+                       (unsigned long long)t->n_drains, (unsigned long long)t->n_infeasible,
+                       t->drain_ns * 1e-3, t->n_drains ? t->drain_ns * 1e-3 / t->n_drains : 0.,
+                       t->max_drain_ns * 1e-3);
+                for (unsigned k = 1; k < C_N_KINDS; k++) {
+                        printf(" %llu", (unsigned long long)t->n_filters[k]);
+                }
+                printf(" %llu %llu %llu\n", (unsigned long long)t->n_quiet,
+                       (unsigned long long)t->n_narrowed, (unsigned long long)t->n_retracted);
+        }
+}
+
+int main(int argc, char ** argv)
+{
+        int summary = (argc == 3 && 0 == strcmp(argv[1], "-s"));
+        if (argc != 2 + summary) {
+                fprintf(stderr, "usage: %s [-s] FILE\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        const char * path = argv[1 + summary];
+        FILE * f = fopen(path, "rb");
+        if (!f) {
+                perror(path);
+                return EXIT_FAILURE;
+        }
+
+        struct Summary s = {0, 0, NULL};
+        struct TraceBlock block;
+        struct TraceEvent e;
+        int ret = EXIT_SUCCESS;
+        while (1 == fread(&block, sizeof(block), 1, f)) {
+                if (TRACE_MAGIC != block.magic || sizeof(struct TraceEvent) != block.event_size) {
+                        fprintf(stderr, "%s: not a trace, or from another machine\n", path);
+                        ret = EXIT_FAILURE;
+                        break;
+                }
+                struct TagSummary * t = summary ? Summary_get(&s, block.tag) : NULL;
+                if (summary && !t) {
+                        fprintf(stderr, "out of memory\n");
+                        ret = EXIT_FAILURE;
+                        break;
+                }
+                for (uint32_t k = 0; k < block.n_events; k++) {
+                        if (1 != fread(&e, sizeof(e), 1, f)) {
+                                fprintf(stderr, "%s: truncated\n", path);
+                                ret = EXIT_FAILURE;
+                                goto done;
+                        }
+                        if (summary) {
+                                Summary_add(t, &e);
+                        } else {
+                                print_event(block.tag, &e);
+                        }
+                }
+        }
+done:
+        if (summary) {
+                Summary_print(&s);
+        }
+        free(s.tags);
+        fclose(f);
+        return ret;
+}
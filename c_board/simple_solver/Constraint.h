@@ -3,6 +3,7 @@
 #include <assert.h>
 
 #include "LNode.h"
+#include "Pool.h"
 #include "Var.h"
 #include "CSError.h"
 
@@ -20,21 +21,42 @@ struct ConstraintVisibility {
 struct ConstraintTile {
         unsigned dir_n[4];
         unsigned target_value;
+        // What the filter last read along each ray. A ray's counts stay
+        // valid while none of its vars before scan_end changes.
+        unsigned scanned;          /**< The counts below have been filled in. */
+        uint64_t scanned_at;       /**< Store clock when they were. */
+        unsigned scan_end[4];      /**< One past the last var index read. */
+        unsigned n_blue_dir[4];    /**< Blues before the first undecided tile. */
+        int      FED_i[4];         /**< First undecided tile, or -1. */
+        unsigned add_one_yield[4]; /**< Blues gained by making it blue. */
 };
 
+enum ConstraintKind {
+        C_NONE = 0,   /**< Not initialised yet. */
+        C_TILE,
+        C_SUM,
+        C_VISIBILITY
+};
+#define C_N_KINDS (C_VISIBILITY + 1)
+
 /**
- * struct Constraint is a tagged union whose tag is @<.filter@>
+ * struct Constraint is a tagged union whose tag is @<.kind@>
  */
 struct Constraint {
         unsigned      id;      /**< Index used by the solver. */
+        struct PoolSet * pool; /**< The owning Problem's allocator. Restrictions come from here. */
         unsigned      n_vars;  /**< Number of variables used by this constraint. */
         struct Var ** vars;    /**< List of pointers to variables.
                                     Every variable used by the filter MUST be in this list. */
-        bitset      * domains; /**< Before invoking a filter, each variable's domain is copied
-                                    here to use as a scratchpad. At some point in the future, this
-                                    will reduce the number of copy operations and cache misses. */
-        CSError    (* filter)(struct Constraint*, struct LNode **);
-        /**< A domain propagation algorithm that also acts as a type tag.
+        unsigned    * var_ids; /**< The same variables as indices into @<store@>. */
+        const struct DomainStore * store; /**< The owning Problem's domains.
+                                               Filters read them in place through @<C_domain()@>. */
+        bitset      * domains; /**< Scratchpad for filters that need one:
+                                    ConstraintSum's support sets. */
+        uint64_t      last_run; /**< Store clock when the filter last ran. */
+        unsigned      quiet;    /**< The last run found no restriction. */
+        enum ConstraintKind kind;
+        /**< Selects the domain propagation algorithm, see @<Constraint_filter()@>.
              Invoking a filter passes back a linked list of domain restrictions.
              The solver applies the domain restrictions when it feels like it.
              Filters invoke @<C_push_restriction_on_nth_var()@> when they find a domain reduction. */
@@ -46,21 +68,40 @@ struct Constraint {
                 which indicate how the constraint's list of pointers is structured. */
 };
 
+/**
+ * An arc of the Restriction DAG. It is stored inline in the child and
+ * threaded into the parent's list of implications, so either end can
+ * unlink it in O(1).
+ */
+struct RestrictionEdge {
+        struct Restriction     * parent;
+        struct Restriction     * child;
+        struct RestrictionEdge * prev; /**< Previous sibling in parent->implications. */
+        struct RestrictionEdge * next; /**< Next sibling in parent->implications. */
+};
+
 struct Restriction {
         struct Var         * var;
         bitset               domain;
         struct Constraint  * constraint;
 
         struct Restriction * var_restrict_prev;      /**< The variable's previous restriction. */
-        struct LNode       * implications;           /**< Linked list of child restrictions. */
+        struct RestrictionEdge * implications;       /**< Doubly linked list of edges to child restrictions. */
+        struct Restriction * instance_prev;          /**< Neighbours in the constraint's list of instances. */
+        struct Restriction * instance_next;
+        struct Restriction * retract_next;           /**< Explicit stack used while retracting. */
         unsigned             n_necessary_conditions; /**< Number of parent restrictions. */
-        struct Restriction * necessary_conditions[]; /**< A flat list of parent restrictions. */
+        struct RestrictionEdge necessary_conditions[]; /**< A flat list of edges to parent restrictions. */
 };
 
-static struct Restriction * Restriction_create(struct Var * v, bitset domain, struct Constraint * c)
+#define C_domain(c, i) ((c)->store->domains[(c)->var_ids[(i)]])
+
+#define Restriction_size(N) (sizeof(struct Restriction) + (N) * sizeof(struct RestrictionEdge))
+
+static struct Restriction * Restriction_create(struct PoolSet * pool, struct Var * v, bitset domain, struct Constraint * c)
 {
         unsigned N = c ? c->n_vars : 0;
-        struct Restriction * r = malloc(sizeof(struct Restriction) + N * sizeof(struct Restriction*));
+        struct Restriction * r = PoolSet_alloc(pool, Restriction_size(N));
         if (!r) { goto bad_alloc1; }
         *r = (struct Restriction){
                 .var                    = v,
@@ -68,24 +109,41 @@ static struct Restriction * Restriction_create(struct Var * v, bitset domain, st
                 .constraint             = c,
                 .var_restrict_prev      = NULL,
                 .implications           = NULL,
+                .instance_prev          = NULL,
+                .instance_next          = NULL,
+                .retract_next           = NULL,
                 .n_necessary_conditions = N};
         return r;
 bad_alloc1:
         return NULL;
 }
 
+static inline void Restriction_destroy(struct PoolSet * pool, struct Restriction * r)
+{
+        PoolSet_free(pool, r, Restriction_size(r->n_necessary_conditions));
+}
+
+// Frees a list of restrictions that never made it into the DAG
+static inline void Restriction_list_destroy(struct PoolSet * pool, struct LNode ** list)
+{
+        while (*list) {
+                struct Restriction * r = LNode_pop_pool(pool, list);
+                Restriction_destroy(pool, r);
+        }
+}
+
 static inline CSError C_push_restriction_on_nth_var(struct Constraint * c, int index, bitset domain, struct LNode ** list)
 {
-        struct Restriction * r = Restriction_create(c->vars[index], domain, c);
+        struct Restriction * r = Restriction_create(c->pool, c->vars[index], domain, c);
         if (!r) {
                 goto bad_alloc1;
         }
-        if (FAIL_ALLOC == LNode_prepend(list, r, 0)) {
+        if (FAIL_ALLOC == LNode_prepend_pool(c->pool, list, r, 0)) {
                 goto bad_alloc2;
         }
         return NO_FAILURE;
 bad_alloc2:
-        free(r);
+        Restriction_destroy(c->pool, r);
 bad_alloc1:
         return FAIL_ALLOC;
 
@@ -93,111 +151,135 @@ bad_alloc1:
 
 // ConstraintTile
 
+// Reads ray d up to and including its second undecided tile or its first
+// red, whichever comes first. Nothing past that point matters to the filter.
+static inline void ConstraintTile_scan(struct Constraint * c, int d)
+{
+        struct ConstraintTile * t = &c->tile_data;
+        unsigned i = d ? t->dir_n[d-1] : 0;
+        unsigned n_empty = 0;
+        t->n_blue_dir[d] = 0;
+        t->FED_i[d] = -1;
+        t->add_one_yield[d] = 0;
+        for (; i < t->dir_n[d]; i++) {
+                bitset domain = C_domain(c, i);
+                if (domain == (RED | BLUE)) {
+                        if (n_empty++) {
+                                i++;
+                                break;
+                        }
+                        t->FED_i[d] = i;
+                        t->add_one_yield[d] = 1;
+                } else if (domain == BLUE) {
+                        if (0 == n_empty) {
+                                t->n_blue_dir[d]++;
+                        } else {
+                                t->add_one_yield[d]++;
+                        }
+                } else if (domain == RED) {
+                        i++;
+                        break;
+                } else {
+                        assert(0);
+                }
+        }
+        t->scan_end[d] = i;
+}
+
+// True if a var ConstraintTile_scan() read on ray d has changed since
+static inline int ConstraintTile_ray_changed(struct Constraint * c, int d)
+{
+        struct ConstraintTile * t = &c->tile_data;
+        for (unsigned i = d ? t->dir_n[d-1] : 0; i < t->scan_end[d]; i++) {
+                if (c->store->stamps[c->var_ids[i]] > t->scanned_at) {
+                        return 1;
+                }
+        }
+        return 0;
+}
+
+// Finds in one pass what repeatedly applying these rules would, stopping
+// where the rules used to stop:
+//   1. If enough blues are visible, every ray ends at its first undecided tile.
+//   2. If only one ray can still grow, its first undecided tile is blue.
+//      Nothing is deduced after this one.
+//   3. If growing a ray by its first undecided tile (and the blues
+//      right behind it) would see too many blues, that tile is red.
+// FAILURE if too many blues are visible, or too few and no ray can grow.
 static inline CSError ConstraintTile_filter(struct Constraint * c, struct LNode ** restrictions_return)
 {
-        int modified;
-        do {
-                modified = 0;
-                unsigned n_blue = 0;
-                unsigned n_blue_dir[4] = {0,0,0,0};
-                // index of the First Empty Domain (FED_i) for each direction
-                // Not using a pointer because we'd like to use the index on the list of vars
-                int FED_i[4] = {-1, -1, -1, -1};
-                unsigned n_empty[4] = {0,0,0,0};
-                unsigned add_one_yield[4] = {0,0,0,0};
-                unsigned how_many_directions = 0;
-                unsigned max_possible = 0;
-                unsigned max_possible_dir[4] = {0,0,0,0};
-                int only_direction = -1;
+        struct ConstraintTile * t = &c->tile_data;
+        // Bring the per-ray counts up to date, rescanning only the rays that changed
+        for (int d = 0; d < 4; d++) {
+                if (!t->scanned || ConstraintTile_ray_changed(c, d)) {
+                        ConstraintTile_scan(c, d);
+                }
+        }
+        t->scanned = 1;
+        t->scanned_at = c->store->clock;
+
+        unsigned n_blue = 0;
+        unsigned how_many_directions = 0;
+        int only_direction = -1;
+        for (int d = 0; d < 4; d++) {
+                n_blue += t->n_blue_dir[d];
+                if (t->FED_i[d] != -1) {
+                        how_many_directions++;
+                        only_direction = d;
+                }
+        }
+        if (n_blue > t->target_value) {
+                goto infeasible;
+        }
 
+        /* 1 */
+        if (n_blue == t->target_value) {
                 for (int d = 0; d < 4; d++) {
-                        for (unsigned i = (d ? c->tile_data.dir_n[d-1] : 0);
-                             i < c->tile_data.dir_n[d];
-                             i++) {
-                                bitset domain = c->domains[i];
-                                if (domain == (RED | BLUE)) {
-                                        if (0 == n_empty[d]) {
-                                                FED_i[d] = i;
-                                                add_one_yield[d]++;
-
-                                                how_many_directions++;
-                                                only_direction = d;
-                                        }
-                                        n_empty[d]++;
-                                } else if (domain == BLUE) {
-                                        if (0 == n_empty[d]) {
-                                                n_blue++;
-                                                n_blue_dir[d]++;
-                                        } else if (1 == n_empty[d]) {
-                                                add_one_yield[d]++;
-                                        }
-                                } else if (domain == RED) {
-                                        break;
-                                } else {
-                                        assert(0);
-                                }
-                                max_possible++;
-                                max_possible_dir[d]++;
+                        int i = t->FED_i[d];
+                        // RED is always more restricted than the domain in question if we get here
+                        if (i != -1 && FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, RED, restrictions_return)) {
+                                goto bad_alloc1;
                         }
                 }
-
-                assert(n_blue <= c->tile_data.target_value);
-                /* 1 */
-                if (n_blue == c->tile_data.target_value) {
-                        for (int d = 0; d < 4; d++) {
-                                int i = FED_i[d];
-                                if (i != -1) {
-                                        c->domains[i] = RED;
-                                        // RED is always more restricted than the domain in question if we get here
-                                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, RED, restrictions_return)) {
-                                                goto bad_alloc1;
-                                        }
-                                        modified = 1;
-                                        break;
-                                }
-                        }
-                /* 2 */
-                } else if (how_many_directions == 1) {
-                        int i = FED_i[only_direction];
-                        c->domains[i] = BLUE;
-                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, BLUE, restrictions_return)) {
+                return NO_FAILURE;
+        }
+        if (how_many_directions == 0) {
+                goto infeasible;
+        }
+        /* 2 */
+        if (how_many_directions == 1) {
+                goto only_one_direction;
+        }
+        /* 3 */
+        unsigned closed = 0;
+        for (int d = 0; d < 4; d++) {
+                int i = t->FED_i[d];
+                if (i != -1 && t->add_one_yield[d] + n_blue > t->target_value) {
+                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, RED, restrictions_return)) {
                                 goto bad_alloc1;
                         }
-                        modified = 1;
-                        break;
-                } else {
-                        for (int d = 0; d < 4; d++) {
-                                unsigned max_possible_other_directions = (max_possible - max_possible_dir[d]);
-                                /* 3 */
-                                if (add_one_yield[d] + n_blue > c->tile_data.target_value) {
-                                        int i = FED_i[d];
-                                        assert(i != -1);
-                                        c->domains[i] = RED;
-                                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, RED, restrictions_return)) {
-                                                goto bad_alloc1;
+                        closed |= 1 << d;
+                        if (--how_many_directions == 1) {
+                                for (only_direction = 0; only_direction < 4; only_direction++) {
+                                        if (t->FED_i[only_direction] != -1 && !(closed & 1 << only_direction)) {
+                                                break;
                                         }
-                                        modified = 1;
-                                        break;
                                 }
-                                /* 4 */
-                                // FIXME: Why does this make worse boards?
-                                // else if (add_one_yield[d] &&
-                                         // add_one_yield[d] + n_blue_dir[d] + max_possible_other_directions <= c->tile_data.target_value) {
-                                            // int i = FED_i[d];
-                                            // c->domains[i] = BLUE;
-                                            // if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, BLUE, restrictions_return)) {
-                                                    // goto bad_alloc1;
-                                            // }
-                                            // modified = 1;
-                                            // break;
-                                // }
+                                goto only_one_direction;
                         }
                 }
-        } while (modified);
+        }
+        return NO_FAILURE;
 
+only_one_direction:
+        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, t->FED_i[only_direction], BLUE, restrictions_return)) {
+                goto bad_alloc1;
+        }
         return NO_FAILURE;
+infeasible:
+        return FAILURE;
 bad_alloc1:
-        LNode_destroy_and_free_data(restrictions_return);
+        Restriction_list_destroy(c->pool, restrictions_return);
         return FAIL_ALLOC;
 }
 // tile_bools is 4 different arrays concatenated together
@@ -208,16 +290,13 @@ static inline CSError ConstraintTile_init(struct Constraint * c,
                                           struct Var ** tile_bools,
                                           unsigned how_many[4])
 {
-        c->filter = ConstraintTile_filter;
+        c->kind = C_TILE;
         c->n_vars = how_many[0] + how_many[1] + how_many[2] + how_many[3];
         c->vars = malloc(c->n_vars * sizeof(struct Var *));
         if (!c->vars) {
                 goto bad_alloc1;
         }
-        c->domains = malloc(c->n_vars * sizeof(bitset));
-        if (!c->domains) {
-                goto bad_alloc2;
-        }
+        c->domains = NULL;
 
         for (unsigned i = 0; i < c->n_vars; i++) {
                 c->vars[i] = tile_bools[i];
@@ -228,89 +307,72 @@ static inline CSError ConstraintTile_init(struct Constraint * c,
         c->tile_data.dir_n[3] = c->tile_data.dir_n[2] + how_many[3];
 
         c->tile_data.target_value = target_value;
+        c->tile_data.scanned = 0;
 
         return NO_FAILURE;
-bad_alloc2:
-        free(c->vars);
 bad_alloc1:
         return FAIL_ALLOC;
 }
 
 // ConstraintSum
 
+#define C_SUM_SCRATCH(N) (2 * ((N) + 1)) /**< Bitsets ConstraintSum_filter() works in. */
+
 /* Following Trick 2003
+ * Each step is a shift/OR over a whole bitset, one per value in a domain,
+ * instead of a test per bit position.
  */
 static inline CSError ConstraintSum_filter(struct Constraint * c, struct LNode ** restrictions_return)
 {
-        unsigned fail = 0;
         unsigned N = c->n_vars;
+        // Scratch space preallocated by ConstraintSum_init()
+        bitset * f = c->domains;
+        bitset * g = c->domains + N + 1;
 
-        bitset * f = malloc((N+1) * sizeof(bitset));
-        if (!f) {
-                fail = FAIL_ALLOC;
-                goto bad_alloc1;
-        }
-        bitset * g = malloc((N+1) * sizeof(bitset));
-        if (!g) {
-                fail = FAIL_ALLOC;
-                goto bad_alloc2;
-        }
-
-        for (unsigned i = 0; i <= N; i++) {
-                f[i] = 0;
-                g[i] = 0;
-        }
+        // f[i] is the set of sums reachable with the first i addends
         f[0] = 1<<0;
         for (unsigned i = 1; i <= N; i++) {
-                for (unsigned b = 0; b < DOMAIN_SIZE; b++) {
-                        if (f[i-1] & (1 << b)) {
-                                f[i] |= c->domains[i-1] << b;
-                        }
+                bitset reachable = f[i-1] & DOMAIN_MASK;
+                f[i] = 0;
+                for (bitset d = C_domain(c, i-1); d; d &= d - 1) {
+                        f[i] |= reachable << bitset_ctz(d);
                 }
         }
 
         g[N] = f[N] & c->sum_data.domain;
-        fail |= !g[N];
-        if (fail) {
-                fail = FAILURE;
-                goto cleanup;
+        if (!g[N]) {
+                return FAILURE;
         }
 
+        // g[i] is the part of f[i] from which a sum in g[N] can still be reached:
+        // b is in g[i] iff there exists a v in domains[i] s.t. b + v is in g[i+1]
         for (int i = N-1; i >= 0; i--) {
-                for (unsigned b = 0; b < DOMAIN_SIZE; b++) {
-                        // The expression
-                        // !!((domains[i] << b) & g[i+1])
-                        //     is 1 iff
-                        //     there exists a v in domains[i]
-                        //              and a u in g[i+1]      s.t.: v + b = u
-                        // The expression
-                        // g[i] |= {1,0} << b
-                        //     writes the result to the appropriate bit
-                        g[i] |= !!((c->domains[i] << b) & g[i+1]) << b;
+                bitset supported = 0;
+                for (bitset d = C_domain(c, i); d; d &= d - 1) {
+                        supported |= g[i+1] >> bitset_ctz(d);
                 }
-                g[i] &= f[i];
+                g[i] = supported & DOMAIN_MASK & f[i];
         }
+        // v stays in domains[i] iff some u in f[i] has u + v in g[i+1]
         for (unsigned i = 0; i < N; i++) {
                 bitset reduced_domain = 0;
-                for (unsigned b = 0; b < DOMAIN_SIZE; b++) {
-                        reduced_domain |= ((c->domains[i] & 1<<b) && ((f[i] << b) & g[i+1])) << b;
+                for (bitset d = C_domain(c, i) & DOMAIN_MASK; d; d &= d - 1) {
+                        unsigned v = bitset_ctz(d);
+                        if ((f[i] << v) & g[i+1]) {
+                                reduced_domain |= (bitset)1 << v;
+                        }
                 }
-                if (c->domains[i] != reduced_domain) {
+                if (C_domain(c, i) != reduced_domain) {
                         if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, reduced_domain, restrictions_return)) {
-                                goto bad_alloc3;
+                                goto bad_alloc1;
                         }
                 }
         }
 
-        goto cleanup;
-bad_alloc3:
-        LNode_destroy_and_free_data(restrictions_return);
-cleanup:
-bad_alloc2:
-        free(g);
+        return NO_FAILURE;
 bad_alloc1:
-        free(f);
-        return fail;
+        Restriction_list_destroy(c->pool, restrictions_return);
+        return FAIL_ALLOC;
 }
 
 static inline CSError ConstraintSum_init(struct Constraint * c,
@@ -318,16 +380,16 @@ static inline CSError ConstraintSum_init(struct Constraint * c,
                                           struct Var ** addends,
                                           unsigned n_addends)
 {
-        c->filter = ConstraintSum_filter;
+        c->kind = C_SUM;
         c->n_vars = n_addends;
         c->vars = malloc(c->n_vars * sizeof(struct Var*));
         if (!c->vars) { goto bad_alloc1; }
-        c->domains = malloc(c->n_vars * sizeof(bitset));
+        // The filter's f and g arrays
+        c->domains = malloc(C_SUM_SCRATCH(c->n_vars) * sizeof(bitset));
         if (!c->domains) { goto bad_alloc2; }
 
         for (unsigned i = 0; i < c->n_vars; i++) {
                 c->vars[i] = addends[i];
-                c->domains[i] = addends[i]->domain;
         }
 
         c->sum_data.domain = domain;
@@ -341,58 +403,104 @@ bad_alloc1:
 
 // ConstraintVisibility
 
-// There's probably a one liner that does this.
-static inline CSError ConstraintVisibility_filter(struct Constraint * c, struct LNode ** restrictions_return)
+#define C_BATCH_MAX 16 /**< Most constraints a batch filter takes at once. */
+
+// Loads the constraint as bitmasks over its lhs variables:
+// which can still be red, which can still be blue, and the count's domain.
+static inline void ConstraintVisibility_gather(struct Constraint * c, bitset * R, bitset * B, bitset * y)
 {
-        unsigned n_lhs = c->n_vars - 1; // Cardinality var
-        unsigned rhs_i = c->n_vars - 1; // Index var
-
-        bitset R = 0;
-        bitset B = 0;
-        bitset y = 0;
-        y = c->domains[rhs_i];
-        for (unsigned b = 0; b < n_lhs; b++) {
-                unsigned isred =  !!HAS_RED(c->domains[b]);
-                R |= isred << b;
-                unsigned isblue = !!HAS_BLUE(c->domains[b]);
-                B |= isblue << b;
-        }
-
-        unsigned blue_fixed = (B & ~R);
-        unsigned red_fixed = (R & ~B);
-        unsigned maxx = 0,
-                 maxy = 0,
-                 miny = 0;
-        for (unsigned b = 0; b < n_lhs; b++) {
-                if (!maxx && red_fixed & 1<<b) { maxx = 1<<b; }
-                if (y & 1<<b) { maxy = 1<<b; }
-                if (!miny && (y & 1<<b)) { miny = 1<<b; }
-        }
-        y = y & ~blue_fixed;
-        y = y & ((maxx<<1)-1);
-        R = R & ~(miny-1);
-        if (maxy == miny) {
-                B = B & ~y;
-        }
-
-        for (unsigned b = 0; b < n_lhs; b++) {
-                bitset reduced_domain = (!!(B & 1<<b) << BLUEBIT) | (!!(R & 1<<b) << REDBIT);
-                if (c->domains[b] != reduced_domain) {
-                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, b, reduced_domain, restrictions_return)) {
+        unsigned n_lhs = c->n_vars - 1;
+        bitset r = 0;
+        bitset b = 0;
+        for (unsigned i = 0; i < n_lhs; i++) {
+                bitset d = C_domain(c, i);
+                r |= ((d >> REDBIT) & 1) << i;
+                b |= ((d >> BLUEBIT) & 1) << i;
+        }
+        *R = r;
+        *B = b;
+        *y = C_domain(c, n_lhs);
+}
+
+// The reasoning itself, without a branch:
+// the count stops at the first fixed red, can't end on a fixed blue,
+// everything before the smallest possible count is blue,
+// and if the count is known, the tile it ends on is red.
+static inline void ConstraintVisibility_reduce(bitset * R, bitset * B, bitset * y, unsigned n_lhs)
+{
+        bitset lhs_mask = ((bitset)1 << n_lhs) - 1;
+        bitset red_fixed = *R & ~*B;
+        bitset blue_fixed = *B & ~*R;
+        bitset maxx = bitset_lowest(red_fixed);
+        bitset miny = bitset_lowest(*y & lhs_mask);
+        bitset maxy = bitset_highest(*y & lhs_mask);
+        bitset reduced_y = *y & ~blue_fixed & ((maxx << 1) - 1);
+        *R &= ~(miny - 1);
+        *B &= ~(reduced_y & -(bitset)(maxy == miny));
+        *y = reduced_y;
+}
+
+// Pushes a restriction for every domain that differs from the masks
+static inline CSError ConstraintVisibility_scatter(struct Constraint * c, bitset R, bitset B, bitset y,
+                                                   struct LNode ** restrictions_return)
+{
+        unsigned n_lhs = c->n_vars - 1;
+        for (unsigned i = 0; i < n_lhs; i++) {
+                bitset reduced_domain = ((B >> i) & 1) << BLUEBIT | ((R >> i) & 1) << REDBIT;
+                if (C_domain(c, i) != reduced_domain) {
+                        if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, i, reduced_domain, restrictions_return)) {
                                 goto bad_alloc1;
                         }
                 }
         }
-        if (c->domains[rhs_i] != y) {
-                if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, rhs_i, y, restrictions_return)) {
-                        goto bad_alloc2;
+        if (C_domain(c, n_lhs) != y) {
+                if (FAIL_ALLOC == C_push_restriction_on_nth_var(c, n_lhs, y, restrictions_return)) {
+                        goto bad_alloc1;
                 }
         }
+        return NO_FAILURE;
+bad_alloc1:
+        Restriction_list_destroy(c->pool, restrictions_return);
+        return FAIL_ALLOC;
+}
+
+static inline CSError ConstraintVisibility_filter(struct Constraint * c, struct LNode ** restrictions_return)
+{
+        bitset R, B, y;
+        ConstraintVisibility_gather(c, &R, &B, &y);
+        ConstraintVisibility_reduce(&R, &B, &y, c->n_vars - 1);
+        return ConstraintVisibility_scatter(c, R, B, y, restrictions_return);
+}
 
+// Filters n <= C_BATCH_MAX Visibility constraints against the same domains.
+// Every load happens first and every restriction is pushed last,
+// so the middle pass is straight-line arithmetic over arrays.
+// restrictions_return[k] receives the restrictions of cs[k].
+static inline CSError ConstraintVisibility_filter_batch(struct Constraint ** cs, unsigned n,
+                                                        struct LNode ** restrictions_return)
+{
+        bitset R[C_BATCH_MAX], B[C_BATCH_MAX], y[C_BATCH_MAX];
+        unsigned n_lhs[C_BATCH_MAX];
+        assert(n <= C_BATCH_MAX);
+
+        for (unsigned k = 0; k < n; k++) {
+                ConstraintVisibility_gather(cs[k], &R[k], &B[k], &y[k]);
+                n_lhs[k] = cs[k]->n_vars - 1;
+                restrictions_return[k] = NULL;
+        }
+        for (unsigned k = 0; k < n; k++) {
+                ConstraintVisibility_reduce(&R[k], &B[k], &y[k], n_lhs[k]);
+        }
+        for (unsigned k = 0; k < n; k++) {
+                if (FAIL_ALLOC == ConstraintVisibility_scatter(cs[k], R[k], B[k], y[k], &restrictions_return[k])) {
+                        goto bad_alloc1;
+                }
+        }
         return NO_FAILURE;
 bad_alloc1:
-bad_alloc2:
-        LNode_destroy_and_free_data(restrictions_return);
+        for (unsigned k = 0; k < n; k++) {
+                Restriction_list_destroy(cs[k]->pool, &restrictions_return[k]);
+        }
         return FAIL_ALLOC;
 }
 
@@ -401,30 +509,26 @@ static inline CSError ConstraintVisibility_init(struct Constraint * c,
                                                 unsigned n_lhsvars,
                                                 struct Var *rhsvar)
 {
-        c->filter = ConstraintVisibility_filter;
+        c->kind = C_VISIBILITY;
         c->n_vars = n_lhsvars + 1;
         c->vars = malloc(c->n_vars * sizeof(struct Var*));
         if (!c->vars) { goto bad_alloc1; }
-        c->domains = malloc(c->n_vars * sizeof(bitset));
-        if (!c->domains) { goto bad_alloc2; }
+        c->domains = NULL;
 
         unsigned i;
         for (i = 0; i < n_lhsvars; i++) {
                 c->vars[i] = lhsvars[i];
-                c->domains[i] = lhsvars[i]->domain;
         }
         c->vars[i] = rhsvar;
 
         return NO_FAILURE;
-bad_alloc2:
-        free(c->vars);
 bad_alloc1:
         return FAIL_ALLOC;
 }
 
 static inline CSError Constraint_generic_destroy(struct Constraint * c)
 {
-        if (!c->vars || !c->domains) {
+        if (!c->vars) {
                 goto fail;
         }
         free(c->vars);
@@ -437,29 +541,191 @@ fail:
 ////////
 // Generic Constraint Functions
 ////////
+// True if the last run found nothing and no watched domain changed since
+static inline int Constraint_is_quiet(struct Constraint * c)
+{
+        if (!c->quiet) {
+                return 0;
+        }
+        for (unsigned i = 0; i < c->n_vars; i++) {
+                if (c->store->stamps[c->var_ids[i]] > c->last_run) {
+                        return 0;
+                }
+        }
+        return 1;
+}
+
 static inline CSError Constraint_filter(struct Constraint * c, struct LNode ** ret)
 {
         if (!ret || !c) {
                 goto bad_input;
         }
-        for (unsigned i = 0; i < c->n_vars; i++) {
-                c->domains[i] = c->vars[i]->domain;
-        }
         *ret = NULL;
-        return c->filter(c, ret);
+        if (Constraint_is_quiet(c)) {
+                return NO_FAILURE;
+        }
+        uint64_t now = c->store->clock;
+        CSError fail;
+        // A switch rather than a function pointer, so the filters inline
+        switch (c->kind) {
+        case C_TILE:
+                fail = ConstraintTile_filter(c, ret);
+                break;
+        case C_SUM:
+                fail = ConstraintSum_filter(c, ret);
+                break;
+        case C_VISIBILITY:
+                fail = ConstraintVisibility_filter(c, ret);
+                break;
+        default:
+                goto bad_input;
+        }
+        // Filters are pure functions of their domains, so a run that found
+        // nothing will find nothing again until one of them changes
+        c->quiet = (NO_FAILURE == fail && NULL == *ret);
+        c->last_run = now;
+        return fail;
+bad_input:
+        return FAIL_PARAM;
+}
+
+// How expensive a filter is to run.
+// The solver drains cheaper classes to a fixpoint before running dearer ones.
+enum CostClass {
+        COST_CHEAP,     /**< ConstraintVisibility: a few mask operations. */
+        COST_MEDIUM,    /**< ConstraintTile: a walk along four rays. */
+        COST_EXPENSIVE, /**< ConstraintSum: a pass over its support sets per addend. */
+        N_COST_CLASSES
+};
+
+static inline enum CostClass Constraint_cost_class(struct Constraint * c)
+{
+        switch (c->kind) {
+        case C_VISIBILITY:
+                return COST_CHEAP;
+        case C_TILE:
+                return COST_MEDIUM;
+        case C_SUM:
+        case C_NONE:
+                break;
+        }
+        return COST_EXPENSIVE;
+}
+
+// The events on its i-th var that can let the filter find something new
+static inline unsigned Constraint_wake_on(struct Constraint * c, unsigned i)
+{
+        switch (c->kind) {
+        case C_TILE:
+                // Only fixed tiles count
+                return EV_FIXED;
+        case C_VISIBILITY:
+                // The tiles only matter once fixed, the count through its bounds
+                return i + 1 < c->n_vars ? EV_FIXED : EV_BOUNDS;
+        case C_SUM:
+        case C_NONE:
+                break;
+        }
+        return EV_ALL;
+}
+
+// True if running the filter again straight after applying its own
+// restrictions never finds anything more.
+// ConstraintSum_filter computes the exact supports, so it is.
+// ConstraintTile_filter stops after some deductions, and
+// ConstraintVisibility_filter only uses a count it narrowed on its next run.
+static inline int Constraint_is_idempotent(struct Constraint * c)
+{
+        return c->kind == C_SUM;
+}
+
+// True if Problem_solve_queue() should run constraints of this kind through
+// Constraint_filter_batch(). None for now: batched Visibility reduces boards
+// slower than the single filter does, so it is only there for callers
+// that want it.
+static inline int Constraint_has_batch(struct Constraint * c)
+{
+        (void)c;
+        return 0;
+}
+
+// Constraint_filter() on each of cs[0..n), which must all be of the same
+// kind, one with a batch filter: C_VISIBILITY.
+// ret[k] receives the restrictions of cs[k]. They were all found against
+// the domains as they were before the call, so two of them may restrict
+// the same var.
+static inline CSError Constraint_filter_batch(struct Constraint ** cs, unsigned n, struct LNode ** ret)
+{
+        struct Constraint * awake[C_BATCH_MAX];
+        struct LNode * found[C_BATCH_MAX];
+        unsigned which[C_BATCH_MAX];
+        unsigned n_awake = 0;
+        if (!cs || !ret || n > C_BATCH_MAX) {
+                goto bad_input;
+        }
+        for (unsigned k = 0; k < n; k++) {
+                ret[k] = NULL;
+                if (!Constraint_is_quiet(cs[k])) {
+                        which[n_awake] = k;
+                        awake[n_awake++] = cs[k];
+                }
+        }
+        if (n_awake == 0) {
+                return NO_FAILURE;
+        }
+        uint64_t now = awake[0]->store->clock;
+        CSError fail;
+        switch (awake[0]->kind) {
+        case C_VISIBILITY:
+                fail = ConstraintVisibility_filter_batch(awake, n_awake, found);
+                break;
+        default:
+                goto bad_input;
+        }
+        if (NO_FAILURE != fail) {
+                return fail;
+        }
+        for (unsigned j = 0; j < n_awake; j++) {
+                ret[which[j]] = found[j];
+                awake[j]->quiet = (NULL == found[j]);
+                awake[j]->last_run = now;
+        }
+        return NO_FAILURE;
 bad_input:
         return FAIL_PARAM;
 }
 
+// Allocates what a constraint of this kind over n_vars vars owns, for a caller
+// that fills in the vars and kind data itself, as Problem_create_from_snapshot() does.
+static inline CSError Constraint_init_empty(struct Constraint * c, enum ConstraintKind kind, unsigned n_vars)
+{
+        c->n_vars = n_vars;
+        c->vars = malloc(n_vars * sizeof(struct Var *));
+        if (!c->vars) { goto bad_alloc1; }
+        c->domains = NULL;
+        if (C_SUM == kind) {
+                c->domains = malloc(C_SUM_SCRATCH(n_vars) * sizeof(bitset));
+                if (!c->domains) { goto bad_alloc2; }
+        }
+        c->kind = kind;
+        return NO_FAILURE;
+bad_alloc2:
+        free(c->vars);
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
 static inline CSError Constraint_destroy(struct Constraint * c)
 {
         CSError fail = NO_FAILURE;
-        if (c->filter == ConstraintSum_filter) {
-                fail = Constraint_generic_destroy(c);
-        } else if (c->filter == ConstraintVisibility_filter) {
-                fail = Constraint_generic_destroy(c);
-        } else if (c->filter == ConstraintTile_filter) {
+        switch (c->kind) {
+        case C_TILE:
+        case C_SUM:
+        case C_VISIBILITY:
                 fail = Constraint_generic_destroy(c);
+                break;
+        case C_NONE:
+                break;
         }
         return fail;
 }
@@ -468,7 +734,7 @@ static inline void Constraint_print(struct Constraint * c)
         printf("id=%u: | N=%u:\n", c->id, c->n_vars);
         for (unsigned i = 0; i < c->n_vars; i++) {
                 printf("%u ", c->vars[i]->id);
-                bitset_print(c->vars[i]->domain);
+                bitset_print(C_domain(c, i));
         }
         printf("\n");
 }
@@ -1,6 +1,7 @@
 #ifndef LNODE_H
 #define LNODE_H
 #include "CSError.h"
+#include "Pool.h"
 #include <stdlib.h>
 
 // Linked list node
@@ -10,11 +11,12 @@ struct LNode {
         struct LNode * next;
 };
 
+// The *_pool variants draw nodes from a PoolSet. A NULL pool uses the heap.
 static inline
-CSError LNode_prepend(struct LNode ** root, void * data, unsigned integer)
+CSError LNode_prepend_pool(struct PoolSet * pool, struct LNode ** root, void * data, unsigned integer)
 {
         if (NULL == root) { goto fail;}
-        struct LNode * new_root = malloc(sizeof(struct LNode));
+        struct LNode * new_root = PoolSet_alloc(pool, sizeof(struct LNode));
         if (NULL == new_root) { goto bad_alloc1; }
         new_root->next = *root;
         new_root->data = data;
@@ -27,20 +29,30 @@ bad_alloc1:
         return FAIL_ALLOC;
 }
 static inline
-void * LNode_pop(struct LNode ** root)
+CSError LNode_prepend(struct LNode ** root, void * data, unsigned integer)
+{
+        return LNode_prepend_pool(NULL, root, data, integer);
+}
+static inline
+void * LNode_pop_pool(struct PoolSet * pool, struct LNode ** root)
 {
         if (NULL == root || NULL == *root) {
                 goto no_root;
         }
         void * ret = (*root)->data;
         struct LNode * next = (*root)->next;
-        free(*root);
+        PoolSet_free(pool, *root, sizeof(struct LNode));
         *root = next;
         return ret;
 no_root:
         return NULL;
 }
 static inline
+void * LNode_pop(struct LNode ** root)
+{
+        return LNode_pop_pool(NULL, root);
+}
+static inline
 void LNode_destroy(struct LNode ** root)
 {
         while (*root) {
@@ -71,19 +83,24 @@ unsigned LNode_count(struct LNode ** root)
         }
 }
 static inline
-CSError LNode_remove_node(struct LNode ** root, void * data)
+CSError LNode_remove_node_pool(struct PoolSet * pool, struct LNode ** root, void * data)
 {
         if (root == NULL || *root == NULL) {
                 return FAILURE;
         }
         if ((*root)->data == data) {
                 struct LNode * next = (*root)->next;
-                free(*root);
+                PoolSet_free(pool, *root, sizeof(struct LNode));
                 *root = next;
                 return NO_FAILURE;
         } else {
-                return LNode_remove_node(&(*root)->next, data);
+                return LNode_remove_node_pool(pool, &(*root)->next, data);
         }
 }
+static inline
+CSError LNode_remove_node(struct LNode ** root, void * data)
+{
+        return LNode_remove_node_pool(NULL, root, data);
+}
 
 #endif
@@ -0,0 +1,175 @@
+#ifndef POOL_H
+#define POOL_H
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CSError.h"
+
+////////
+// Size-classed slab allocator
+////////
+// Objects are rounded up to a power of two (at least POOL_MIN_OBJECT) and
+// carved out of slabs owned by the pool. Freed objects go onto a per-class
+// free list. Nothing is returned to the heap until PoolSet_release(), which
+// drops every slab at once.
+// A NULL pool means "use the heap", so callers that have no pool keep working.
+
+#define POOL_MIN_SHIFT   4
+#define POOL_MIN_OBJECT  (1 << POOL_MIN_SHIFT)
+#define POOL_N_CLASSES   9     // 16 .. 4096 bytes
+#define POOL_SLAB_BYTES  8192
+
+struct PoolSlab {
+        struct PoolSlab * next;
+        max_align_t       data[];
+};
+
+struct PoolFree {
+        struct PoolFree * next;
+};
+
+struct PoolClass {
+        struct PoolFree * free_list;
+        unsigned char   * bump;     /**< Next unused byte in the newest slab. */
+        unsigned char   * bump_end;
+};
+
+struct PoolSet {
+        struct PoolClass  classes[POOL_N_CLASSES];
+        struct PoolSlab * slabs;    /**< Every slab, oversized objects included. */
+        size_t            n_objects;  /**< Objects handed out and not yet freed. */
+        size_t            n_bytes;    /**< Bytes those objects occupy, after rounding. */
+        size_t            n_slab_bytes;
+};
+
+static inline void PoolSet_init(struct PoolSet * ps)
+{
+        *ps = (struct PoolSet){
+                .slabs        = NULL,
+                .n_objects    = 0,
+                .n_bytes      = 0,
+                .n_slab_bytes = 0};
+        for (unsigned k = 0; k < POOL_N_CLASSES; k++) {
+                ps->classes[k] = (struct PoolClass){NULL, NULL, NULL};
+        }
+}
+
+static inline struct PoolSet * PoolSet_create()
+{
+        struct PoolSet * ps = malloc(sizeof(struct PoolSet));
+        if (!ps) {
+                return NULL;
+        }
+        PoolSet_init(ps);
+        return ps;
+}
+
+// Returns POOL_N_CLASSES if the object is too big for any class
+static inline unsigned Pool_class_of(size_t size)
+{
+        unsigned k = 0;
+        size_t class_size = POOL_MIN_OBJECT;
+        while (class_size < size && k < POOL_N_CLASSES) {
+                class_size <<= 1;
+                k++;
+        }
+        return k;
+}
+#define Pool_class_size(k) ((size_t)POOL_MIN_OBJECT << (k))
+
+static inline struct PoolSlab * PoolSet_new_slab(struct PoolSet * ps, size_t bytes)
+{
+        struct PoolSlab * slab = malloc(sizeof(struct PoolSlab) + bytes);
+        if (!slab) {
+                return NULL;
+        }
+        slab->next = ps->slabs;
+        ps->slabs = slab;
+        ps->n_slab_bytes += bytes;
+        return slab;
+}
+
+static inline void * PoolSet_alloc(struct PoolSet * ps, size_t size)
+{
+        if (!ps) {
+                return malloc(size);
+        }
+        unsigned k = Pool_class_of(size);
+        void * ret = NULL;
+        if (k == POOL_N_CLASSES) {
+                // Oversized: give it a slab of its own. It is only reclaimed on release.
+                struct PoolSlab * slab = PoolSet_new_slab(ps, size);
+                if (!slab) { goto bad_alloc1; }
+                ps->n_bytes += size;
+                ps->n_objects++;
+                return slab->data;
+        }
+        struct PoolClass * pc = &ps->classes[k];
+        size_t class_size = Pool_class_size(k);
+        if (pc->free_list) {
+                ret = pc->free_list;
+                pc->free_list = pc->free_list->next;
+        } else {
+                if (!pc->bump || (size_t)(pc->bump_end - pc->bump) < class_size) {
+                        size_t slab_bytes = class_size > POOL_SLAB_BYTES ? class_size : POOL_SLAB_BYTES;
+                        struct PoolSlab * slab = PoolSet_new_slab(ps, slab_bytes);
+                        if (!slab) { goto bad_alloc1; }
+                        pc->bump = (unsigned char *)slab->data;
+                        pc->bump_end = pc->bump + slab_bytes;
+                }
+                ret = pc->bump;
+                pc->bump += class_size;
+        }
+        ps->n_bytes += class_size;
+        ps->n_objects++;
+        return ret;
+bad_alloc1:
+        return NULL;
+}
+
+static inline void PoolSet_free(struct PoolSet * ps, void * ptr, size_t size)
+{
+        if (!ps) {
+                free(ptr);
+                return;
+        }
+        if (!ptr) {
+                return;
+        }
+        unsigned k = Pool_class_of(size);
+        ps->n_objects--;
+        if (k == POOL_N_CLASSES) {
+                ps->n_bytes -= size;
+                return;
+        }
+        struct PoolFree * node = ptr;
+        node->next = ps->classes[k].free_list;
+        ps->classes[k].free_list = node;
+        ps->n_bytes -= Pool_class_size(k);
+}
+
+/**
+ * Bulk teardown: every object allocated from the pool becomes invalid.
+ * The pool itself stays usable.
+ */
+static inline void PoolSet_release(struct PoolSet * ps)
+{
+        if (!ps) {
+                return;
+        }
+        while (ps->slabs) {
+                struct PoolSlab * next = ps->slabs->next;
+                free(ps->slabs);
+                ps->slabs = next;
+        }
+        PoolSet_init(ps);
+}
+
+static inline void PoolSet_destroy(struct PoolSet * ps)
+{
+        PoolSet_release(ps);
+        free(ps);
+}
+
+#endif // POOL_H
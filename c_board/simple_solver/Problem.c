@@ -1,5 +1,5 @@
 #include "Problem.h"
-#include "QueueSet_void_ptr.h"
+#include <string.h>
 
 struct Problem * Problem_create()
 {
@@ -16,165 +16,465 @@ struct Problem * Problem_create()
                 .var_registry      = NULL,
                 .var_registry_data = NULL,
                 .c_registry        = NULL,
-                .DAG_data          = NULL};
-        p->Q = QueueSet_create_void_ptr();
+                .store             = {.domains = NULL, .stamps = NULL, .clock = 0},
+                .recent_restriction = NULL,
+                .instances         = NULL,
+                .DAG_data          = NULL,
+                .Q                 = {{.ring = NULL, .in_queue = NULL}},
+                .trail             = {.enabled = 0, .n_entries = 0, .capacity = 0, .entries = NULL}};
+        // The worklists are sized in Problem_create_registry(), once the constraints are known
+        PoolSet_init(&p->pool);
         return p;
 bad_alloc1:
         return NULL;
 }
 
 CSError Problem_enqueue_related_constraints(struct Problem * p, struct Var * v)
+{
+        return Problem_notify(p, v, EV_ALL, NULL);
+}
+
+// Enqueues the active constraints on v that subscribe to one of events.
+// cause, the constraint that made the change, is left out if it is
+// idempotent: it has already seen its own deductions.
+CSError Problem_notify(struct Problem * p, struct Var * v, unsigned events, struct Constraint * cause)
 {
         struct VarRegister * vreg = P_var_register(p, v);
-        for (struct Constraint ** cp = vreg->constraint;
-             cp < vreg->constraint + vreg->n_active_constraints;
-             cp++) {
-                if ( ! P_cons_is_active(p, *cp)) {
+        unsigned skip = (cause && Constraint_is_idempotent(cause)) ? cause->id : p->n_constraints;
+        for (unsigned k = 0; k < vreg->n_active_constraints; k++) {
+                unsigned c_id = vreg->constraint[k];
+                if (!(vreg->wake_on[k] & events) || c_id == skip) {
+                        continue;
+                }
+                if ( ! p->c_registry[c_id].active) {
                         continue;
                 }
-                QueueSet_insert_void_ptr(p->Q, *cp);
+                Problem_enqueue(p, c_id);
         }
         return NO_FAILURE;
 }
 
 CSError Problem_add_DAG_node(struct Problem * p, struct Restriction * r)
 {
-        struct VarRegister * vreg = P_var_register(p, r->var);
         if (r->constraint) {
-                struct ConstraintRegister * creg = P_cons_register(p, r->constraint);
+                struct Restriction ** instances = &P_instances(p, r->constraint);
                 r->n_necessary_conditions = r->constraint->n_vars;
 
-                // Restrict the domain in question at this time
-
-                // Add it to the c_registry's linked list
-
                 // Find all the necessary condition variables
                 // Get their corresponding most recent restrictions
-                // Put them in an array and assign to r->necessary_conditions
-
+                // and link r into each of their implications through the inline edges
                 for (unsigned i = 0; i < r->n_necessary_conditions; i++) {
                         struct Var * current = r->constraint->vars[i];
-                        struct Restriction * parent = P_var_register(p, current)->most_recent_restriction;
-
-                        r->necessary_conditions[i] = parent;
-                        // Append the present restriction to its parents' implications linked lists
-                        // (Potentially using a custom allocator)
+                        struct Restriction * parent = P_recent_restriction(p, current);
+                        struct RestrictionEdge * e = &r->necessary_conditions[i];
                         assert(parent != NULL);
-                        LNode_prepend(&parent->implications, r, 0);
-                        // assert(LNode_count(parent->implications) != 0);
+
+                        *e = (struct RestrictionEdge){
+                                .parent = parent,
+                                .child  = r,
+                                .prev   = NULL,
+                                .next   = parent->implications};
+                        if (parent->implications) {
+                                parent->implications->prev = e;
+                        }
+                        parent->implications = e;
                 }
 
-                LNode_prepend(&creg->instances, r, 0);
+                // Add it to the c_registry's list
+                r->instance_prev = NULL;
+                r->instance_next = *instances;
+                if (*instances) {
+                        (*instances)->instance_prev = r;
+                }
+                *instances = r;
         }
-        Var_set(r->var, r->domain);
-        // Update the var_registry's most recent restriction link
+        P_set_domain(p, r->var, r->domain);
+        // Update the var's most recent restriction link
         // and remember var_restrict_prev
-        r->var_restrict_prev = vreg->most_recent_restriction;
-        vreg->most_recent_restriction = r;
+        r->var_restrict_prev = P_recent_restriction(p, r->var);
+        P_recent_restriction(p, r->var) = r;
         p->n_DAG_nodes++;
+        P_STATS(p, restrictions_created++);
+        P_STATS_PEAK(p);
         return NO_FAILURE;
 }
-// TODO: flush the cached domains or determine that they're fine
-static CSError Problem_remove_DAG_node(struct Problem * p, struct Restriction * r, unsigned enqueue_invalidated_arcs)
+// Detach r from its constraint's instances and from its parents' implications.
+// Costs O(number of parents).
+static void Problem_unlink_DAG_node(struct Problem * p, struct Restriction * r)
 {
-        int fail = NO_FAILURE;
-        struct VarRegister * vreg = P_var_register(p, r->var);
         if (r->constraint) {
-                struct ConstraintRegister * creg = P_cons_register(p, r->constraint);
-                // Need to remove it from c_registry
-                fail = LNode_remove_node(&creg->instances, r);
-                NOFAIL(fail);
-                // Go to r's parents and remove r from their implications (traversing backwards?)
+                if (r->instance_prev) {
+                        r->instance_prev->instance_next = r->instance_next;
+                } else {
+                        assert(P_instances(p, r->constraint) == r);
+                        P_instances(p, r->constraint) = r->instance_next;
+                }
+                if (r->instance_next) {
+                        r->instance_next->instance_prev = r->instance_prev;
+                }
                 for (unsigned i = 0; i < r->n_necessary_conditions; i++) {
-                        assert(r->necessary_conditions[i]->implications);
-                        fail = LNode_remove_node(&r->necessary_conditions[i]->implications, r);
-                        NOFAIL(fail);
+                        struct RestrictionEdge * e = &r->necessary_conditions[i];
+                        if (e->prev) {
+                                e->prev->next = e->next;
+                        } else {
+                                assert(e->parent->implications == e);
+                                e->parent->implications = e->next;
+                        }
+                        if (e->next) {
+                                e->next->prev = e->prev;
+                        }
                 }
         } else {
                 assert(r->n_necessary_conditions == 0);
         }
-        while (r->implications) {
-                Problem_remove_DAG_node(p, r->implications->data, enqueue_invalidated_arcs);
-                // This call removes the top element from r's implications also
+}
+// TODO: flush the cached domains or determine that they're fine
+// Retracts r and everything it implies, newest child first.
+// Children are retracted before their parents restore their var's domain,
+// exactly as a recursive post-order walk would, but with an explicit stack
+// threaded through retract_next so deep chains cannot overflow.
+static CSError Problem_remove_DAG_node(struct Problem * p, struct Restriction * r, unsigned enqueue_invalidated_arcs)
+{
+        Problem_unlink_DAG_node(p, r);
+        r->retract_next = NULL;
+        struct Restriction * stack = r;
+        while (stack) {
+                struct Restriction * top = stack;
+                if (top->implications) {
+                        struct Restriction * child = top->implications->child;
+                        // This removes the edge from top's implications also
+                        Problem_unlink_DAG_node(p, child);
+                        child->retract_next = stack;
+                        stack = child;
+                        continue;
+                }
+                stack = top->retract_next;
+
+                P_recent_restriction(p, top->var) = top->var_restrict_prev;
+                if (top->var_restrict_prev) {
+                        P_set_domain(p, top->var, top->var_restrict_prev->domain);
+                        P_TRACE(p, TRACE_RETRACT, top->var->id, P_domain(p, top->var), 0, 0);
+                }
+
+                if (enqueue_invalidated_arcs) {
+                        Problem_enqueue_related_constraints(p, top->var);
+                }
+
+                Restriction_destroy(&p->pool, top);
+                p->n_DAG_nodes--;
+                P_STATS(p, restrictions_retracted++);
         }
+        return NO_FAILURE;
+}
 
-        vreg->most_recent_restriction = r->var_restrict_prev;
-        if (r->var_restrict_prev) {
-                Var_set(r->var, r->var_restrict_prev->domain);
+static CSError Problem_trail_push(struct Problem * p, struct Var * v, unsigned c_id, bitset old)
+{
+        struct Trail * t = &p->trail;
+        if (t->n_entries == t->capacity) {
+                unsigned capacity = t->capacity ? 2 * t->capacity : 4 * p->n_vars + 16;
+                struct TrailEntry * entries = realloc(t->entries, capacity * sizeof(struct TrailEntry));
+                if (!entries) {
+                        goto bad_alloc1;
+                }
+                t->entries = entries;
+                t->capacity = capacity;
         }
+        t->entries[t->n_entries++] = (struct TrailEntry){.var = v, .c_id = c_id, .old = old};
+        return NO_FAILURE;
+bad_alloc1:
+        return FAIL_ALLOC;
+}
 
-        if (enqueue_invalidated_arcs) {
-                Problem_enqueue_related_constraints(p, r->var);
+static CSError Problem_trail_set_domain(struct Problem * p, struct Var * v, bitset domain)
+{
+        if (FAIL_ALLOC == Problem_trail_push(p, v, 0, P_domain(p, v))) {
+                return FAIL_ALLOC;
         }
+        P_set_domain(p, v, domain);
+        P_STATS(p, restrictions_created++);
+        return NO_FAILURE;
+}
 
-        free(r);
-        p->n_DAG_nodes--;
+CSError Problem_set_trail_mode(struct Problem * p, unsigned enabled)
+{
+        if (!enabled && p->trail.enabled) {
+                Problem_backtrack_to(p, 0);
+        }
+        p->trail.enabled = enabled;
         return NO_FAILURE;
 }
 
+unsigned Problem_push_checkpoint(struct Problem * p)
+{
+        assert(p->trail.enabled);
+        return p->trail.n_entries;
+}
+
+void Problem_backtrack_to(struct Problem * p, unsigned checkpoint)
+{
+        struct Trail * t = &p->trail;
+        assert(checkpoint <= t->n_entries);
+        while (t->n_entries > checkpoint) {
+                struct TrailEntry * e = &t->entries[--t->n_entries];
+                if (e->var) {
+                        P_set_domain(p, e->var, e->old);
+                        P_STATS(p, restrictions_retracted++);
+                        P_TRACE(p, TRACE_RETRACT, e->var->id, e->old, 0, 0);
+                } else {
+                        p->c_registry[e->c_id].active = e->old;
+                }
+        }
+        // Checkpoints are taken at a fixpoint; whatever was queued since is moot
+        Problem_queue_clear(p);
+}
+
 CSError Problem_solve_queue(struct Problem * p)
 {
         int fail = NO_FAILURE;
-        struct QueueSet_void_ptr * Q = p->Q;
-        while (Q->n_entries != 0) {
-                // Pop from Queue
-                void * ptr = NULL;
-                fail = QueueSet_pop_void_ptr(Q, &ptr);
-                struct Constraint * c = ptr;
+        struct Constraint * batch[C_BATCH_MAX];
+        struct LNode * found[C_BATCH_MAX];
+        P_TRACE(p, TRACE_DRAIN_BEGIN, 0, Problem_queue_length(p), 0, 0);
+        while ( ! Problem_queue_is_empty(p)) {
+                // Pop from Queue, cheapest class first
+                unsigned c_id = 0;
+                fail = Problem_dequeue(p, &c_id);
+                struct Constraint * c = p->c_registry[c_id].constraint;
                 NOFAIL(fail);
                 // printf("%lu yolo %lu\n", (unsigned long)p, (unsigned long)c->id);
                 if ( ! (p)->c_registry[(c)->id].active) {
                         continue;
                 }
-                struct LNode * restrictions = NULL;
-                fail = Constraint_filter(c, &restrictions);
+                unsigned n = 1;
+                batch[0] = c;
+                if (Constraint_has_batch(c)) {
+                        // Take along the run of same-kind constraints at the head of the queue
+                        while (n < C_BATCH_MAX && NO_FAILURE == Problem_queue_peek(p, &c_id)) {
+                                struct Constraint * next = p->c_registry[c_id].constraint;
+                                if (next->kind != c->kind) {
+                                        break;
+                                }
+                                Problem_dequeue(p, NULL);
+                                if (p->c_registry[c_id].active) {
+                                        batch[n++] = next;
+                                }
+                        }
+                }
+#if CS_STATS
+                for (unsigned k = 0; k < n; k++) {
+                        P_STATS(p, filter_calls[batch[k]->kind]++);
+                        P_STATS(p, filter_quiet += Constraint_is_quiet(batch[k]));
+                }
+#endif
+#if CS_TRACE
+                for (unsigned k = 0; p->trace && k < n; k++) {
+                        P_TRACE(p, TRACE_FILTER, batch[k]->id, Constraint_is_quiet(batch[k]), 0, batch[k]->kind);
+                }
+#endif
+                if (Constraint_has_batch(c)) {
+                        fail = Constraint_filter_batch(batch, n, found);
+                } else {
+                        fail = Constraint_filter(c, &found[0]);
+                }
+                if (FAILURE == fail) {
+                        for (unsigned k = 0; k < n; k++) {
+                                Restriction_list_destroy(&p->pool, &found[k]);
+                        }
+                        goto infeasible;
+                }
                 NOFAIL(fail);
-                while (restrictions) {
-                        // If a domain reduction is found, call Problem_add_DAG_node()
-                        struct Restriction * r = LNode_pop(&restrictions);
-                        if (r->domain == 0) {
-                                goto infeasible;
+                for (unsigned k = 0; k < n; k++) {
+                        while (found[k]) {
+                                // If a domain reduction is found, call Problem_add_DAG_node()
+                                struct Restriction * r = LNode_pop_pool(&p->pool, &found[k]);
+                                bitset old = P_domain(p, r->var);
+                                bitset proposed = r->domain;
+                                // Members of a batch read their domains up front,
+                                // so an earlier one may have narrowed this var already
+                                r->domain &= old;
+                                if (r->domain == old) {
+                                        Restriction_destroy(&p->pool, r);
+                                        P_STATS(p, restrictions_redundant++);
+                                        continue;
+                                }
+                                if (r->domain == 0) {
+                                        Restriction_destroy(&p->pool, r);
+                                        for (unsigned j = k; j < n; j++) {
+                                                Restriction_list_destroy(&p->pool, &found[j]);
+                                        }
+                                        goto infeasible;
+                                }
+                                unsigned events = bitset_events(old, r->domain);
+                                P_TRACE(p, TRACE_NARROW, r->var->id, r->domain, r->constraint->id, r->constraint->kind);
+                                // If the result isn't what the filter proposed, it has to see it too
+                                struct Constraint * cause = (r->domain == proposed) ? r->constraint : NULL;
+                                if (P_trail_mode(p)) {
+                                        struct Var * v = r->var;
+                                        fail = Problem_trail_set_domain(p, v, r->domain);
+                                        Restriction_destroy(&p->pool, r);
+                                        NOFAIL(fail);
+                                        Problem_notify(p, v, events, cause);
+                                        continue;
+                                }
+                                // TODO: all restrictions in the list should have the same necessary conditions
+                                //       instead of depending on their siblings.
+                                fail = Problem_add_DAG_node(p, r);
+                                NOFAIL(fail);
+                                // Push the arcs that touch this var and care about what happened
+                                Problem_notify(p, r->var, events, cause);
                         }
-                        // TODO: all restrictions in the list should have the same necessary conditions
-                        //       instead of depending on their siblings.
-                        fail = Problem_add_DAG_node(p, r);
-                        NOFAIL(fail);
-                        // Push every arc that touches one of this var's constraints
-                        Problem_enqueue_related_constraints(p, r->var);
                 }
         }
+        P_TRACE(p, TRACE_DRAIN_END, 0, 0, 0, 0);
         return NO_FAILURE;
 infeasible:
+        P_STATS(p, infeasible++);
+        P_TRACE(p, TRACE_DRAIN_END, 0, 1, 0, 0);
         return FAILURE;
 }
 
 CSError Problem_solve(struct Problem * p)
 {
-        struct QueueSet_void_ptr * Q = p->Q;
         // Initialize Queue
         for (unsigned c_i = 0; c_i < p->n_constraints; c_i++) {
                 struct ConstraintRegister * cr = &p->c_registry[c_i];
                 if (cr->active == 0) {
                         continue;
                 }
-                QueueSet_insert_void_ptr(Q, cr->constraint);
+                Problem_enqueue(p, c_i);
         }
 
         return Problem_solve_queue(p);
 }
 
+// How many active constraints look at a var
+static unsigned Problem_var_degree(struct Problem * p, struct Var * v)
+{
+        struct VarRegister * vreg = P_var_register(p, v);
+        unsigned degree = 0;
+        for (unsigned k = 0; k < vreg->n_constraints; k++) {
+                degree += p->c_registry[vreg->constraint[k]].active;
+        }
+        return degree;
+}
+
+// Among vars[0..n_vars), the undecided one with the fewest values left,
+// then the most active constraints on it. NULL if there is none.
+static struct Var * Problem_branch_var(struct Problem * p, struct Var * vars, unsigned n_vars)
+{
+        struct Var * best = NULL;
+        unsigned best_width = DOMAIN_SIZE + 1;
+        unsigned best_degree = 0;
+        for (unsigned i = 0; i < n_vars; i++) {
+                bitset domain = P_domain(p, &vars[i]);
+                if (domain == bitset_lowest(domain)) {
+                        continue;
+                }
+                unsigned width = __builtin_popcountll(domain);
+                if (width > best_width) {
+                        continue;
+                }
+                unsigned degree = Problem_var_degree(p, &vars[i]);
+                if (width < best_width || degree > best_degree) {
+                        best = &vars[i];
+                        best_width = width;
+                        best_degree = degree;
+                }
+        }
+        return best;
+}
+
+// The domain a var was last reset to, before anything was derived from it
+static bitset Problem_root_domain(struct Problem * p, struct Var * v)
+{
+        struct Restriction * r = P_recent_restriction(p, v);
+        while (r->var_restrict_prev) {
+                r = r->var_restrict_prev;
+        }
+        return r->domain;
+}
+
+// p is at a fixpoint
+static CSError Problem_search(struct Problem * p, struct Var * vars, unsigned n_vars,
+                              unsigned limit, unsigned * n_solutions)
+{
+        int fail = NO_FAILURE;
+        struct Var * v = Problem_branch_var(p, vars, n_vars);
+        if (!v) {
+                (*n_solutions)++;
+                return NO_FAILURE;
+        }
+        bitset domain = P_domain(p, v);
+        bitset root = P_trail_mode(p) ? 0 : Problem_root_domain(p, v);
+        for (bitset rest = domain; rest && *n_solutions < limit; rest &= rest - 1) {
+                unsigned checkpoint = P_trail_mode(p) ? Problem_push_checkpoint(p) : 0;
+                fail = Problem_var_reset_domain(p, v, bitset_lowest(rest));
+                if (FAIL_ALLOC == fail) {
+                        goto bad_alloc1;
+                }
+                fail = Problem_solve_queue(p);
+                if (NO_FAILURE == fail) {
+                        fail = Problem_search(p, vars, n_vars, limit, n_solutions);
+                }
+                if (FAIL_ALLOC == fail) {
+                        goto bad_alloc1;
+                }
+                // Undo the decision, and with it everything derived since
+                if (P_trail_mode(p)) {
+                        Problem_backtrack_to(p, checkpoint);
+                        continue;
+                }
+                Problem_queue_clear(p);
+                fail = Problem_var_reset_domain(p, v, root);
+                if (FAIL_ALLOC == fail) {
+                        goto bad_alloc1;
+                }
+                // Back to the fixpoint this node started from
+                fail = Problem_solve_queue(p);
+                if (FAIL_ALLOC == fail) {
+                        goto bad_alloc1;
+                }
+                assert(NO_FAILURE == fail);
+        }
+        return NO_FAILURE;
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+CSError Problem_count_solutions(struct Problem * p, struct Var * vars, unsigned n_vars,
+                                unsigned limit, unsigned * n_solutions)
+{
+        *n_solutions = 0;
+        if (0 == limit) {
+                return NO_FAILURE;
+        }
+        int fail = Problem_solve(p);
+        if (FAILURE == fail) {
+                Problem_queue_clear(p);
+                return NO_FAILURE;
+        }
+        if (FAIL_ALLOC == fail) {
+                return FAIL_ALLOC;
+        }
+        return Problem_search(p, vars, n_vars, limit, n_solutions);
+}
 
 CSError Problem_constraint_deactivate(struct Problem * p, struct Constraint * c)
 {
         // find registry member
         struct ConstraintRegister * cr = P_cons_register(p, c);
         assert(cr);
+        if (P_trail_mode(p)) {
+                if (FAIL_ALLOC == Problem_trail_push(p, NULL, c->id, cr->active)) {
+                        return FAIL_ALLOC;
+                }
+                cr->active = 0;
+                return NO_FAILURE;
+        }
         // change the flag
         cr->active = 0;
         // destroy each reference in the list
-        while (cr->instances) {
-                // struct Restriction * r = LNode_pop(&cr->instances);
-                Problem_remove_DAG_node(p, cr->instances->data, 1);
+        while (P_instances(p, c)) {
+                Problem_remove_DAG_node(p, P_instances(p, c), 1);
         }
 
         return NO_FAILURE;
@@ -182,27 +482,31 @@ CSError Problem_constraint_deactivate(struct Problem * p, struct Constraint * c)
 CSError Problem_constraint_activate(struct Problem * p, struct Constraint * c)
 {
         struct ConstraintRegister * cr = P_cons_register(p, c);
-        cr->active = 1;
-
-        for (unsigned j = 0; j < c->n_vars; j++) {
-                assert(c->vars[j]);
-                QueueSet_insert_void_ptr(p->Q, c);
+        if (P_trail_mode(p) && FAIL_ALLOC == Problem_trail_push(p, NULL, c->id, cr->active)) {
+                return FAIL_ALLOC;
         }
+        cr->active = 1;
+        Problem_enqueue(p, c->id);
 
         return NO_FAILURE;
 }
 CSError Problem_var_reset_domain(struct Problem * p, struct Var * v, bitset domain)
 {
-        struct VarRegister * vr = P_var_register(p, v);
-        // struct Restriction * mrr = vr->most_recent_restriction
+        if (P_trail_mode(p)) {
+                if (FAIL_ALLOC == Problem_trail_set_domain(p, v, domain)) {
+                        goto bad_alloc1;
+                }
+                Problem_enqueue_related_constraints(p, v);
+                return NO_FAILURE;
+        }
         // Destroy all dependent restrictions
-        while (vr->most_recent_restriction) {
-                struct Restriction * r = vr->most_recent_restriction;
-                vr->most_recent_restriction = r->var_restrict_prev;
+        while (P_recent_restriction(p, v)) {
+                struct Restriction * r = P_recent_restriction(p, v);
+                P_recent_restriction(p, v) = r->var_restrict_prev;
                 Problem_remove_DAG_node(p, r, 1);
         }
-        assert(vr->most_recent_restriction == NULL);
-        struct Restriction * r = Restriction_create(v, domain, NULL);
+        assert(P_recent_restriction(p, v) == NULL);
+        struct Restriction * r = Restriction_create(&p->pool, v, domain, NULL);
         if (r == NULL) {
                 goto bad_alloc1;
         }
@@ -210,7 +514,7 @@ CSError Problem_var_reset_domain(struct Problem * p, struct Var * v, bitset doma
 
         Problem_enqueue_related_constraints(p, v);
         // Change the initial node's domain
-        v->domain = domain;
+        P_set_domain(p, v, domain);
         return NO_FAILURE;
 bad_alloc1:
         return FAIL_ALLOC;
@@ -219,16 +523,18 @@ static CSError Problem_DAG_init(struct Problem * p)
 {
         int i;
         for (i = 0; i < (int)p->n_vars; i++) {
-                struct Restriction * r = Restriction_create(p->var_registry[i].var, p->var_registry[i].var->domain, NULL);
+                struct Restriction * r = Restriction_create(&p->pool, p->var_registry[i].var, p->store.domains[i], NULL);
                 if (r == NULL) { goto bad_alloc1; }
-                p->var_registry[i].most_recent_restriction = r; // put in registry
+                p->recent_restriction[i] = r; // put in registry
         }
         p->n_DAG_nodes = p->n_vars;
+        P_STATS_PEAK(p);
         return NO_FAILURE;
 bad_alloc1:
-        for (i = i; i >= 0; i--) {
-                free(p->var_registry[i].most_recent_restriction);
-                p->var_registry[i].most_recent_restriction = NULL;
+        // Slot i is still empty
+        while (i-- > 0) {
+                Restriction_destroy(&p->pool, p->recent_restriction[i]);
+                p->recent_restriction[i] = NULL;
         }
 
         return FAIL_ALLOC;
@@ -241,6 +547,14 @@ CSError Problem_create_registry(struct Problem * p)
         if (!c_register) { goto bad_alloc1; }
         struct VarRegister * var_registry = malloc(p->n_vars * sizeof(struct VarRegister));
         if (!var_registry) { goto bad_alloc2; }
+        bitset * domains = malloc(p->n_vars * sizeof(bitset));
+        if (!domains) { goto bad_alloc3; }
+        uint64_t * stamps = calloc(p->n_vars, sizeof(uint64_t));
+        if (!stamps) { goto bad_alloc4; }
+        struct Restriction ** recent_restriction = calloc(p->n_vars, sizeof(struct Restriction *));
+        if (!recent_restriction) { goto bad_alloc5; }
+        struct Restriction ** instances = calloc(p->n_constraints, sizeof(struct Restriction *));
+        if (!instances) { goto bad_alloc6; }
         // Init all constraints
         struct LNode * block = p->constraint_llist;
         while (block) {
@@ -250,7 +564,7 @@ CSError Problem_create_registry(struct Problem * p)
                         // printf("id: %u\n", id);
                         c_register[id].constraint = c;
                         c_register[id].active = 1;
-                        c_register[id].instances = NULL;
+                        c_register[id].cost_class = Constraint_cost_class(c);
                 }
                 block = block->next;
         }
@@ -264,7 +578,8 @@ CSError Problem_create_registry(struct Problem * p)
                         var_registry[v_id].n_constraints = 0;
                         var_registry[v_id].n_active_constraints = 0;
                         var_registry[v_id].constraint = NULL;
-                        var_registry[v_id].most_recent_restriction = NULL;
+                        var_registry[v_id].wake_on = NULL;
+                        domains[v_id] = vars[i].domain;
                 }
                 block = block->next;
         }
@@ -274,29 +589,36 @@ CSError Problem_create_registry(struct Problem * p)
                 assert(cr->constraint != NULL);
                 struct Var ** vars = cr->constraint->vars;
                 for (unsigned v_i = 0; v_i < cr->constraint->n_vars; v_i++) {
-                        // printf("v_i %u\n", v_i);
-                        // printf("vars %ul\n", vars[v_i]);
                         unsigned v_id = vars[v_i]->id;
                         var_registry[v_id].n_constraints += 1;
                         total_array_size += 1;
                 }
         }
-        // Pass 2: Allocate all register tables
-        struct Constraint ** constraint_buffer = malloc(total_array_size * sizeof(struct Constraint*));
-        if (!constraint_buffer) { goto bad_alloc3; }
+        // Pass 2: Allocate all register tables.
+        // The first third holds each var's constraint ids,
+        // the second third holds each constraint's var ids,
+        // the last third holds the events each var's constraints wake on.
+        unsigned * id_buffer = malloc(3 * total_array_size * sizeof(unsigned));
+        if (!id_buffer) { goto bad_alloc7; }
         unsigned offset = 0;
         for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
                 if (var_registry[v_id].n_constraints) {
-                        var_registry[v_id].constraint = constraint_buffer + offset;
+                        var_registry[v_id].constraint = id_buffer + offset;
+                        var_registry[v_id].wake_on = id_buffer + 2 * total_array_size + offset;
                 } // else remain NULL
                 offset += var_registry[v_id].n_constraints;
         }
         // Pass 3: Build all arrays
         for (struct ConstraintRegister * cr = c_register; cr != c_register + p->n_constraints; cr++) {
-                struct Var ** vars = cr->constraint->vars;
-                for (unsigned v_i = 0; v_i < cr->constraint->n_vars; v_i++) {
-                        struct VarRegister * v_reg = &var_registry[vars[v_i]->id];
-                        v_reg->constraint[v_reg->n_active_constraints++] = cr->constraint;
+                struct Constraint * c = cr->constraint;
+                c->var_ids = id_buffer + offset;
+                c->store = &p->store;
+                offset += c->n_vars;
+                for (unsigned v_i = 0; v_i < c->n_vars; v_i++) {
+                        struct VarRegister * v_reg = &var_registry[c->vars[v_i]->id];
+                        v_reg->wake_on[v_reg->n_active_constraints] = Constraint_wake_on(c, v_i);
+                        v_reg->constraint[v_reg->n_active_constraints++] = c->id;
+                        c->var_ids[v_i] = c->vars[v_i]->id;
                 }
         }
         for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
@@ -304,18 +626,50 @@ CSError Problem_create_registry(struct Problem * p)
                         var_registry[v_id].n_active_constraints);
         }
 
+        unsigned k;
+        for (k = 0; k < N_COST_CLASSES; k++) {
+                if (FAIL_ALLOC == Worklist_init(&p->Q[k], p->n_constraints)) { goto bad_alloc8; }
+        }
+
         p->var_registry = var_registry;
-        p->var_registry_data = constraint_buffer;
+        p->var_registry_data = id_buffer;
         p->c_registry = c_register;
+        p->store.domains = domains;
+        p->store.stamps = stamps;
+        p->recent_restriction = recent_restriction;
+        p->instances = instances;
 
-        Problem_DAG_init(p);
+        if (FAIL_ALLOC == Problem_DAG_init(p)) {
+                goto bad_alloc9;
+        }
 
         return NO_FAILURE;
 
+bad_alloc9:
+        p->var_registry = NULL;
+        p->var_registry_data = NULL;
+        p->c_registry = NULL;
+        p->store.domains = NULL;
+        p->store.stamps = NULL;
+        p->recent_restriction = NULL;
+        p->instances = NULL;
+bad_alloc8:
+        while (k-- > 0) {
+                Worklist_destroy(&p->Q[k]);
+        }
+        free(id_buffer);
+bad_alloc7:
+        free(instances);
+bad_alloc6:
+        free(recent_restriction);
+bad_alloc5:
+        free(stamps);
+bad_alloc4:
+        free(domains);
 bad_alloc3:
-        free(constraint_buffer);
-bad_alloc2:
         free(var_registry);
+bad_alloc2:
+        free(c_register);
 bad_alloc1:
         return FAIL_ALLOC;
 }
@@ -327,7 +681,10 @@ struct Var * Problem_create_vars(struct Problem * p, unsigned n, unsigned domain
         if (!block) {
                 return NULL;
         }
-        LNode_prepend(&p->var_llist, block, n);
+        if (FAIL_ALLOC == LNode_prepend(&p->var_llist, block, n)) {
+                free(block);
+                return NULL;
+        }
         for (unsigned i = 0; i < n; i++) {
                 Var_create(&block[i], p->n_vars++, domain_width, (1<<(domain_width))-1 );
         }
@@ -341,32 +698,616 @@ struct Constraint * Problem_create_empty_constraints(struct Problem * p, unsigne
         if (!block) {
                 return NULL;
         }
-        LNode_prepend(&p->constraint_llist, block, n);
+        if (FAIL_ALLOC == LNode_prepend(&p->constraint_llist, block, n)) {
+                free(block);
+                return NULL;
+        }
         // printf("%lu\n",(unsigned long)p->constraint_llist);
         for (unsigned i = 0; i < n; i++) {
                 block[i].id = p->n_constraints++;
+                block[i].pool = &p->pool;
+                block[i].kind = C_NONE;
+                block[i].quiet = 0;
+                block[i].last_run = 0;
         }
         return block;
 }
 
 void Problem_destroy(struct Problem * p)
 {
-        if (p->c_registry) {
-                for (unsigned c_i = 0; c_i < p->n_constraints; c_i++) {
-                        Constraint_destroy(p->c_registry[c_i].constraint);
-                        while (p->c_registry[c_i].instances) {
-                                Problem_remove_DAG_node(p, p->c_registry[c_i].instances->data, 0);
-                        }
+        // By block rather than through the registry, which may not exist yet.
+        // Constraints start out as C_NONE, so ones never initialised are fine.
+        for (struct LNode * block = p->constraint_llist; block; block = block->next) {
+                struct Constraint * list = block->data;
+                for (struct Constraint * c = list; c < list + block->integer; c++) {
+                        Constraint_destroy(c);
                 }
-                free(p->c_registry);
         }
+        free(p->c_registry);
         if (p->var_registry) {
                 assert(p->var_registry_data);
                 free(p->var_registry);
                 free(p->var_registry_data);
+                free(p->store.domains);
+                free(p->store.stamps);
+                free(p->recent_restriction);
+                free(p->instances);
         }
-        QueueSet_destroy_void_ptr(p->Q);
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                Worklist_destroy(&p->Q[k]);
+        }
+        free(p->trail.entries);
+        Problem_trace_stop(p);
+        // The whole DAG lives in the pool, so there is no need to walk it
+        PoolSet_release(&p->pool);
 
         LNode_destroy_and_free_data(&p->var_llist);
         LNode_destroy_and_free_data(&p->constraint_llist);
+        free(p);
+}
+
+void Problem_get_memory_usage(struct Problem * p, size_t * bytes, size_t * objects)
+{
+        if (bytes) {
+                *bytes = p->pool.n_bytes;
+        }
+        if (objects) {
+                *objects = p->pool.n_objects;
+        }
+}
+
+CSError Problem_get_stats(struct Problem * p, struct ProblemStats * stats)
+{
+#if CS_STATS
+        *stats = p->stats;
+        return NO_FAILURE;
+#else
+        (void)p;
+        *stats = (struct ProblemStats){.peak_DAG_nodes = 0};
+        return FAILURE;
+#endif
+}
+
+////////
+// Tracing
+////////
+#if CS_TRACE
+void Trace_flush(struct Trace * t)
+{
+        struct TraceBlock block = {
+                .magic      = TRACE_MAGIC,
+                .tag        = t->tag,
+                .n_events   = t->n_events,
+                .event_size = sizeof(struct TraceEvent)};
+        if (t->n_events == 0) {
+                return;
+        }
+        // Other problems may write to the same file
+        flockfile(t->out);
+        fwrite(&block, sizeof(block), 1, t->out);
+        fwrite(t->events, sizeof(struct TraceEvent), t->n_events, t->out);
+        funlockfile(t->out);
+        t->n_events = 0;
+}
+#endif
+
+CSError Problem_trace_start(struct Problem * p, FILE * out, uint32_t tag, unsigned capacity)
+{
+#if CS_TRACE
+        if (!out || capacity == 0) {
+                goto bad_param;
+        }
+        Problem_trace_stop(p);
+        struct Trace * t = malloc(sizeof(struct Trace) + capacity * sizeof(struct TraceEvent));
+        if (!t) {
+                goto bad_alloc1;
+        }
+        *t = (struct Trace){
+                .out      = out,
+                .tag      = tag,
+                .start    = Trace_clock(),
+                .capacity = capacity,
+                .n_events = 0};
+        p->trace = t;
+        return NO_FAILURE;
+bad_alloc1:
+        return FAIL_ALLOC;
+bad_param:
+        return FAIL_PARAM;
+#else
+        (void)p; (void)out; (void)tag; (void)capacity;
+        return FAILURE;
+#endif
+}
+
+CSError Problem_trace_stop(struct Problem * p)
+{
+#if CS_TRACE
+        if (p->trace) {
+                Trace_flush(p->trace);
+                free(p->trace);
+                p->trace = NULL;
+        }
+        return NO_FAILURE;
+#else
+        (void)p;
+        return FAILURE;
+#endif
+}
+
+////////
+// Snapshots
+////////
+// A snapshot is one malloc'd block of fixed-width fields, in this order:
+//   header
+//   vars:         N, initial domain, domain, stamp
+//   constraints:  kind, n_vars, active, cost class, quiet, last run, kind data, var ids
+//   restrictions: var, domain, constraint, previous on the var, one parent per
+//                 constraint var. Numbered along each var's chain, oldest first.
+//   newest restriction of each var
+//   implications: for each restriction, its edges (child, slot) newest first
+//   instances:    for each constraint, its restrictions newest first
+//   queues:       ids in pop order, one queue per cost class
+//   trail:        var id, constraint id, old value
+// Everything refers to everything else by id or index, never by address,
+// so the block can be copied, moved or written out as it is.
+#define SNAPSHOT_MAGIC 0x304e3068u
+#define SNAPSHOT_NONE  UINT32_MAX
+
+struct SnapshotHeader {
+        uint32_t magic;
+        uint32_t n_vars;
+        uint32_t n_constraints;
+        uint32_t n_restrictions;
+        uint32_t n_queued[N_COST_CLASSES];
+        uint32_t n_trail_entries;
+        uint32_t trail_enabled;
+        uint64_t clock;
+        uint64_t size;
+};
+
+// Writes if at is set, only measures otherwise
+struct SnapshotCursor {
+        unsigned char * at;
+        size_t          offset;
+};
+
+struct SnapshotReader {
+        const unsigned char * at;
+        size_t                offset;
+};
+
+static void Snapshot_put(struct SnapshotCursor * sc, const void * data, size_t n)
+{
+        if (sc->at) {
+                memcpy(sc->at + sc->offset, data, n);
+        }
+        sc->offset += n;
+}
+static void Snapshot_put32(struct SnapshotCursor * sc, uint32_t x)
+{
+        Snapshot_put(sc, &x, sizeof(x));
+}
+static void Snapshot_put64(struct SnapshotCursor * sc, uint64_t x)
+{
+        Snapshot_put(sc, &x, sizeof(x));
+}
+static void Snapshot_get(struct SnapshotReader * sr, void * data, size_t n)
+{
+        if (data) {
+                memcpy(data, sr->at + sr->offset, n);
+        }
+        sr->offset += n;
+}
+static uint32_t Snapshot_get32(struct SnapshotReader * sr)
+{
+        uint32_t x;
+        Snapshot_get(sr, &x, sizeof(x));
+        return x;
+}
+static uint64_t Snapshot_get64(struct SnapshotReader * sr)
+{
+        uint64_t x;
+        Snapshot_get(sr, &x, sizeof(x));
+        return x;
+}
+
+// Where a constraint keeps its kind-specific data, and how much there is
+static size_t Snapshot_kind_data(struct Constraint * c, void ** data)
+{
+        switch (c->kind) {
+        case C_TILE:
+                *data = &c->tile_data;
+                return sizeof(c->tile_data);
+        case C_SUM:
+                *data = &c->sum_data;
+                return sizeof(c->sum_data);
+        case C_VISIBILITY:
+                *data = &c->visibility_data;
+                return sizeof(c->visibility_data);
+        case C_NONE:
+                break;
+        }
+        *data = NULL;
+        return 0;
+}
+
+// The number r is written under: restrictions are numbered along each var's
+// chain, oldest first, from chain_start[var id]. Chains are short, as each
+// link narrows the domain.
+static uint32_t Snapshot_index_of(struct Problem * p, const unsigned * chain_start, const struct Restriction * r)
+{
+        unsigned v_id = r->var->id;
+        unsigned n_newer = 0;
+        for (struct Restriction * s = p->recent_restriction[v_id]; s != r; s = s->var_restrict_prev) {
+                n_newer++;
+        }
+        return chain_start[v_id + 1] - 1 - n_newer;
+}
+
+static void Problem_write_snapshot(struct Problem * p, struct SnapshotCursor * sc, uint64_t size,
+                                   struct Restriction ** nodes, const unsigned * chain_start)
+{
+        unsigned n_nodes = p->n_DAG_nodes;
+        struct SnapshotHeader h = {
+                .magic           = SNAPSHOT_MAGIC,
+                .n_vars          = p->n_vars,
+                .n_constraints   = p->n_constraints,
+                .n_restrictions  = n_nodes,
+                .n_trail_entries = p->trail.n_entries,
+                .trail_enabled   = p->trail.enabled,
+                .clock           = p->store.clock,
+                .size            = size};
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                h.n_queued[k] = p->Q[k].n_entries;
+        }
+        Snapshot_put(sc, &h, sizeof(h));
+
+        for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
+                struct Var * v = p->var_registry[v_id].var;
+                Snapshot_put32(sc, v->N);
+                Snapshot_put32(sc, v->domain);
+                Snapshot_put32(sc, p->store.domains[v_id]);
+                Snapshot_put64(sc, p->store.stamps[v_id]);
+        }
+        for (unsigned c_id = 0; c_id < p->n_constraints; c_id++) {
+                struct ConstraintRegister * cr = &p->c_registry[c_id];
+                struct Constraint * c = cr->constraint;
+                void * data;
+                size_t data_size = Snapshot_kind_data(c, &data);
+                Snapshot_put32(sc, c->kind);
+                Snapshot_put32(sc, c->n_vars);
+                Snapshot_put32(sc, cr->active);
+                Snapshot_put32(sc, cr->cost_class);
+                Snapshot_put32(sc, c->quiet);
+                Snapshot_put64(sc, c->last_run);
+                Snapshot_put(sc, data, data_size);
+                for (unsigned i = 0; i < c->n_vars; i++) {
+                        Snapshot_put32(sc, c->var_ids[i]);
+                }
+        }
+        for (unsigned k = 0; k < n_nodes; k++) {
+                struct Restriction * r = nodes[k];
+                assert(!r->var_restrict_prev || r->var_restrict_prev == nodes[k - 1]);
+                Snapshot_put32(sc, r->var->id);
+                Snapshot_put32(sc, r->domain);
+                Snapshot_put32(sc, r->constraint ? r->constraint->id : SNAPSHOT_NONE);
+                Snapshot_put32(sc, r->var_restrict_prev ? k - 1 : SNAPSHOT_NONE);
+                for (unsigned i = 0; i < r->n_necessary_conditions; i++) {
+                        Snapshot_put32(sc, Snapshot_index_of(p, chain_start, r->necessary_conditions[i].parent));
+                }
+        }
+        for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
+                unsigned length = chain_start[v_id + 1] - chain_start[v_id];
+                Snapshot_put32(sc, length ? chain_start[v_id + 1] - 1 : SNAPSHOT_NONE);
+        }
+        for (unsigned k = 0; k < n_nodes; k++) {
+                unsigned n_edges = 0;
+                for (struct RestrictionEdge * e = nodes[k]->implications; e; e = e->next) {
+                        n_edges++;
+                }
+                Snapshot_put32(sc, n_edges);
+                for (struct RestrictionEdge * e = nodes[k]->implications; e; e = e->next) {
+                        Snapshot_put32(sc, Snapshot_index_of(p, chain_start, e->child));
+                        Snapshot_put32(sc, e - e->child->necessary_conditions);
+                }
+        }
+        for (unsigned c_id = 0; c_id < p->n_constraints; c_id++) {
+                unsigned n_instances = 0;
+                for (struct Restriction * r = p->instances[c_id]; r; r = r->instance_next) {
+                        n_instances++;
+                }
+                Snapshot_put32(sc, n_instances);
+                for (struct Restriction * r = p->instances[c_id]; r; r = r->instance_next) {
+                        Snapshot_put32(sc, Snapshot_index_of(p, chain_start, r));
+                }
+        }
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                struct Worklist * w = &p->Q[k];
+                for (unsigned j = 0; j < w->n_entries; j++) {
+                        Snapshot_put32(sc, w->ring[(w->head + j) % w->capacity]);
+                }
+        }
+        for (unsigned j = 0; j < p->trail.n_entries; j++) {
+                struct TrailEntry * e = &p->trail.entries[j];
+                Snapshot_put32(sc, e->var ? e->var->id : SNAPSHOT_NONE);
+                Snapshot_put32(sc, e->c_id);
+                Snapshot_put32(sc, e->old);
+        }
+}
+
+CSError Problem_snapshot(struct Problem * p, void ** buffer, size_t * size)
+{
+        assert(p->c_registry);
+        unsigned n_nodes = p->n_DAG_nodes;
+        struct Restriction ** nodes = malloc((n_nodes + 1) * sizeof(struct Restriction *));
+        if (!nodes) { goto bad_alloc1; }
+        unsigned * chain_start = malloc((p->n_vars + 1) * sizeof(unsigned));
+        if (!chain_start) { goto bad_alloc2; }
+
+        // Number the restrictions along each var's chain, oldest first
+        unsigned n = 0;
+        for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
+                chain_start[v_id] = n;
+                for (struct Restriction * r = p->recent_restriction[v_id]; r; r = r->var_restrict_prev) {
+                        n++;
+                }
+                unsigned k = n;
+                for (struct Restriction * r = p->recent_restriction[v_id]; r; r = r->var_restrict_prev) {
+                        nodes[--k] = r;
+                }
+        }
+        chain_start[p->n_vars] = n;
+        assert(n == n_nodes);
+
+        struct SnapshotCursor sc = {.at = NULL, .offset = 0};
+        Problem_write_snapshot(p, &sc, 0, nodes, chain_start);
+        size_t total = sc.offset;
+        sc = (struct SnapshotCursor){.at = malloc(total), .offset = 0};
+        if (!sc.at) { goto bad_alloc3; }
+        Problem_write_snapshot(p, &sc, total, nodes, chain_start);
+        assert(sc.offset == total);
+
+        free(chain_start);
+        free(nodes);
+        *buffer = sc.at;
+        *size = total;
+        return NO_FAILURE;
+bad_alloc3:
+        free(chain_start);
+bad_alloc2:
+        free(nodes);
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+// Hands every restriction back to the pool
+static void Problem_free_DAG(struct Problem * p)
+{
+        for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
+                while (p->recent_restriction[v_id]) {
+                        struct Restriction * r = p->recent_restriction[v_id];
+                        p->recent_restriction[v_id] = r->var_restrict_prev;
+                        Restriction_destroy(&p->pool, r);
+                }
+        }
+        for (unsigned c_id = 0; c_id < p->n_constraints; c_id++) {
+                p->instances[c_id] = NULL;
+        }
+        p->n_DAG_nodes = 0;
+}
+
+CSError Problem_restore(struct Problem * p, const void * buffer)
+{
+        struct SnapshotReader sr = {.at = buffer, .offset = 0};
+        struct SnapshotHeader h;
+        Snapshot_get(&sr, &h, sizeof(h));
+        if (SNAPSHOT_MAGIC != h.magic || h.n_vars != p->n_vars || h.n_constraints != p->n_constraints) {
+                goto bad_param;
+        }
+        // Check the constraints are p's before anything is touched
+        size_t vars_offset = sr.offset;
+        for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
+                Snapshot_get(&sr, NULL, 3 * sizeof(uint32_t) + sizeof(uint64_t));
+        }
+        for (unsigned c_id = 0; c_id < p->n_constraints; c_id++) {
+                struct Constraint * c = p->c_registry[c_id].constraint;
+                void * data;
+                size_t data_size = Snapshot_kind_data(c, &data);
+                if (c->kind != Snapshot_get32(&sr) || c->n_vars != Snapshot_get32(&sr)) {
+                        goto bad_param;
+                }
+                Snapshot_get(&sr, NULL, 3 * sizeof(uint32_t) + sizeof(uint64_t) + data_size);
+                for (unsigned i = 0; i < c->n_vars; i++) {
+                        if (c->var_ids[i] != Snapshot_get32(&sr)) {
+                                goto bad_param;
+                        }
+                }
+        }
+        struct Restriction ** nodes = malloc((h.n_restrictions + 1) * sizeof(struct Restriction *));
+        if (!nodes) { goto bad_alloc1; }
+        struct Trail * t = &p->trail;
+        if (h.n_trail_entries > t->capacity) {
+                struct TrailEntry * entries = realloc(t->entries, h.n_trail_entries * sizeof(struct TrailEntry));
+                if (!entries) { goto bad_alloc2; }
+                t->entries = entries;
+                t->capacity = h.n_trail_entries;
+        }
+
+        Problem_free_DAG(p);
+        sr.offset = vars_offset;
+        for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
+                struct Var * v = p->var_registry[v_id].var;
+                Snapshot_get32(&sr);
+                v->domain = Snapshot_get32(&sr);
+                p->store.domains[v_id] = Snapshot_get32(&sr);
+                p->store.stamps[v_id] = Snapshot_get64(&sr);
+        }
+        p->store.clock = h.clock;
+        for (unsigned c_id = 0; c_id < p->n_constraints; c_id++) {
+                struct ConstraintRegister * cr = &p->c_registry[c_id];
+                struct Constraint * c = cr->constraint;
+                void * data;
+                size_t data_size = Snapshot_kind_data(c, &data);
+                Snapshot_get(&sr, NULL, 2 * sizeof(uint32_t));
+                cr->active = Snapshot_get32(&sr);
+                cr->cost_class = Snapshot_get32(&sr);
+                c->quiet = Snapshot_get32(&sr);
+                c->last_run = Snapshot_get64(&sr);
+                Snapshot_get(&sr, data, data_size);
+                Snapshot_get(&sr, NULL, c->n_vars * sizeof(uint32_t));
+        }
+
+        // Restrictions first, then their parents, which may come later
+        size_t restrictions_offset = sr.offset;
+        for (unsigned k = 0; k < h.n_restrictions; k++) {
+                struct Var * v = p->var_registry[Snapshot_get32(&sr)].var;
+                bitset domain = Snapshot_get32(&sr);
+                uint32_t c_id = Snapshot_get32(&sr);
+                struct Constraint * c = (SNAPSHOT_NONE == c_id) ? NULL : p->c_registry[c_id].constraint;
+                Snapshot_get32(&sr);
+                nodes[k] = Restriction_create(&p->pool, v, domain, c);
+                if (!nodes[k]) {
+                        while (k-- > 0) {
+                                Restriction_destroy(&p->pool, nodes[k]);
+                        }
+                        goto bad_alloc2;
+                }
+                Snapshot_get(&sr, NULL, nodes[k]->n_necessary_conditions * sizeof(uint32_t));
+        }
+        sr.offset = restrictions_offset;
+        for (unsigned k = 0; k < h.n_restrictions; k++) {
+                struct Restriction * r = nodes[k];
+                Snapshot_get(&sr, NULL, 3 * sizeof(uint32_t));
+                uint32_t prev = Snapshot_get32(&sr);
+                r->var_restrict_prev = (SNAPSHOT_NONE == prev) ? NULL : nodes[prev];
+                for (unsigned i = 0; i < r->n_necessary_conditions; i++) {
+                        r->necessary_conditions[i] = (struct RestrictionEdge){
+                                .parent = nodes[Snapshot_get32(&sr)],
+                                .child  = r,
+                                .prev   = NULL,
+                                .next   = NULL};
+                }
+        }
+        for (unsigned v_id = 0; v_id < p->n_vars; v_id++) {
+                uint32_t k = Snapshot_get32(&sr);
+                p->recent_restriction[v_id] = (SNAPSHOT_NONE == k) ? NULL : nodes[k];
+        }
+        for (unsigned k = 0; k < h.n_restrictions; k++) {
+                struct RestrictionEdge * last = NULL;
+                unsigned n_edges = Snapshot_get32(&sr);
+                for (unsigned j = 0; j < n_edges; j++) {
+                        struct Restriction * child = nodes[Snapshot_get32(&sr)];
+                        struct RestrictionEdge * e = &child->necessary_conditions[Snapshot_get32(&sr)];
+                        e->prev = last;
+                        if (last) {
+                                last->next = e;
+                        } else {
+                                nodes[k]->implications = e;
+                        }
+                        last = e;
+                }
+        }
+        for (unsigned c_id = 0; c_id < p->n_constraints; c_id++) {
+                struct Restriction * last = NULL;
+                unsigned n_instances = Snapshot_get32(&sr);
+                for (unsigned j = 0; j < n_instances; j++) {
+                        struct Restriction * r = nodes[Snapshot_get32(&sr)];
+                        r->instance_prev = last;
+                        if (last) {
+                                last->instance_next = r;
+                        } else {
+                                p->instances[c_id] = r;
+                        }
+                        last = r;
+                }
+        }
+        p->n_DAG_nodes = h.n_restrictions;
+        P_STATS_PEAK(p);
+
+        Problem_queue_clear(p);
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                for (unsigned j = 0; j < h.n_queued[k]; j++) {
+                        Worklist_insert(&p->Q[k], Snapshot_get32(&sr));
+                }
+        }
+        for (unsigned j = 0; j < h.n_trail_entries; j++) {
+                uint32_t v_id = Snapshot_get32(&sr);
+                t->entries[j].var = (SNAPSHOT_NONE == v_id) ? NULL : p->var_registry[v_id].var;
+                t->entries[j].c_id = Snapshot_get32(&sr);
+                t->entries[j].old = Snapshot_get32(&sr);
+        }
+        t->n_entries = h.n_trail_entries;
+        t->enabled = h.trail_enabled;
+        assert(sr.offset == h.size);
+
+        free(nodes);
+        return NO_FAILURE;
+bad_alloc2:
+        free(nodes);
+bad_alloc1:
+        return FAIL_ALLOC;
+bad_param:
+        return FAIL_PARAM;
+}
+
+struct Problem * Problem_create_from_snapshot(const void * buffer)
+{
+        struct SnapshotReader sr = {.at = buffer, .offset = 0};
+        struct SnapshotHeader h;
+        Snapshot_get(&sr, &h, sizeof(h));
+        if (SNAPSHOT_MAGIC != h.magic) {
+                goto bad_param;
+        }
+        struct Problem * p = Problem_create();
+        if (!p) { goto bad_alloc1; }
+        struct Var * vars = Problem_create_vars(p, h.n_vars, 1);
+        if (!vars) { goto bad_alloc2; }
+        for (unsigned v_id = 0; v_id < h.n_vars; v_id++) {
+                unsigned N = Snapshot_get32(&sr);
+                bitset domain = Snapshot_get32(&sr);
+                Var_create(&vars[v_id], v_id, N, domain);
+                Snapshot_get(&sr, NULL, sizeof(uint32_t) + sizeof(uint64_t));
+        }
+        struct Constraint * constraints = Problem_create_empty_constraints(p, h.n_constraints);
+        if (!constraints) { goto bad_alloc2; }
+        for (unsigned c_id = 0; c_id < h.n_constraints; c_id++) {
+                struct Constraint * c = &constraints[c_id];
+                enum ConstraintKind kind = Snapshot_get32(&sr);
+                unsigned n_vars = Snapshot_get32(&sr);
+                if (FAIL_ALLOC == Constraint_init_empty(c, kind, n_vars)) {
+                        goto bad_alloc2;
+                }
+                void * data;
+                size_t data_size = Snapshot_kind_data(c, &data);
+                // The rest is restored by Problem_restore()
+                Snapshot_get(&sr, NULL, 3 * sizeof(uint32_t) + sizeof(uint64_t) + data_size);
+                for (unsigned i = 0; i < n_vars; i++) {
+                        c->vars[i] = &vars[Snapshot_get32(&sr)];
+                }
+        }
+        if (FAIL_ALLOC == Problem_create_registry(p)) {
+                goto bad_alloc2;
+        }
+        if (NO_FAILURE != Problem_restore(p, buffer)) {
+                goto bad_alloc2;
+        }
+        return p;
+bad_alloc2:
+        Problem_destroy(p);
+bad_alloc1:
+bad_param:
+        return NULL;
+}
+
+struct Problem * Problem_clone(struct Problem * p)
+{
+        void * buffer;
+        size_t size;
+        if (FAIL_ALLOC == Problem_snapshot(p, &buffer, &size)) {
+                return NULL;
+        }
+        struct Problem * clone = Problem_create_from_snapshot(buffer);
+        free(buffer);
+        return clone;
 }
@@ -9,29 +9,70 @@
 #include "Constraint.h"
 #include "CSError.h"
 #include "LNode.h"
+#include "Pool.h"
+#include "Worklist.h"
+#include "Trace.h"
 
 #define pln printf("%s %i\n", __FILE__, __LINE__)
 
 #define D_TRUE 1
 #define D_FALSE 0
 
-// List of all related constraints
+// Solver counters, see struct ProblemStats. Compiled out unless built
+// with -DCS_STATS=1 (cmake -DOHNO_STATS=ON).
+#ifndef CS_STATS
+#        define CS_STATS 0
+#endif
+
+// List of all related constraints, by id
 // Inactive constraints are put at the end of the list
+// Only the fields propagation touches live here. Provenance lives in
+// Problem::recent_restriction and Problem::instances.
 struct VarRegister {
         struct Var         * var;
         unsigned             n_constraints;
         unsigned             n_active_constraints;
-        struct Constraint ** constraint;
-
-        struct Restriction * most_recent_restriction;
+        unsigned           * constraint;
+        unsigned           * wake_on;   // Events each of those constraints subscribes to here
 };
 // This could contain the list of all adjacent variables,
 // but instead it's just a pointer to the corresponding constraint.
 struct ConstraintRegister {
         struct Constraint * constraint;
         unsigned            active;
+        unsigned            cost_class; // Which of Problem::Q it is queued in
+};
+
+// One undo record. Either a var's previous domain,
+// or (var == NULL) a constraint's previous active flag.
+struct TrailEntry {
+        struct Var * var;
+        unsigned     c_id;
+        bitset       old;
+};
+
+// Chronological alternative to the Restriction DAG.
+// While enabled, narrowings, resets and (de)activations are recorded here
+// instead of in the DAG, and are undone by Problem_backtrack_to().
+struct Trail {
+        unsigned            enabled;
+        unsigned            n_entries;
+        unsigned            capacity;
+        struct TrailEntry * entries;
+};
 
-        struct LNode      * instances; // (struct Restriction*)instances->data
+// What the solver has done since the problem was created.
+// Each counter is a running total, except peak_DAG_nodes.
+struct ProblemStats {
+        uint64_t filter_calls[C_N_KINDS]; /**< Filters invoked, by ConstraintKind, quiet ones included. */
+        uint64_t filter_quiet;           /**< Of those, how many were skipped as quiet. */
+        uint64_t restrictions_created;   /**< Domains narrowed or reset, through the DAG or the trail. */
+        uint64_t restrictions_redundant; /**< Found by a filter but already implied. */
+        uint64_t restrictions_retracted; /**< Undone by a retraction or a backtrack. */
+        uint64_t peak_DAG_nodes;         /**< Largest n_DAG_nodes seen. */
+        uint64_t queue_inserts;          /**< Constraints queued. */
+        uint64_t queue_duplicates;       /**< Inserts dropped as the constraint was queued already. */
+        uint64_t infeasible;             /**< Times Problem_solve_queue() hit an empty domain. */
 };
 
 struct Problem {
@@ -47,9 +88,27 @@ struct Problem {
         void                      * var_registry_data;
         struct ConstraintRegister * c_registry;
 
+        // Structure of arrays, filled in by Problem_create_registry()
+        struct DomainStore          store;              // Current domain of each var, by id
+        struct Restriction       ** recent_restriction; // Cold: newest restriction of each var
+        struct Restriction       ** instances;          // Cold: each constraint's restrictions,
+                                                        //       linked through instance_next, newest first
+
         void                      * DAG_data;
 
-        struct QueueSet_void_ptr  * Q;
+        struct Worklist             Q[N_COST_CLASSES]; // Constraint ids waiting to be filtered,
+                                                       // one queue per cost class
+
+        // Restrictions and their LNodes come from here
+        struct PoolSet              pool;
+
+        struct Trail                trail;
+#if CS_STATS
+        struct ProblemStats         stats;
+#endif
+#if CS_TRACE
+        struct Trace              * trace; // While tracing, else NULL
+#endif
 };
 
 struct Problem * Problem_create();
@@ -61,17 +120,146 @@ struct Var * Problem_create_vars(struct Problem * p, unsigned n, unsigned domain
 struct Constraint * Problem_create_empty_constraints(struct Problem * p, unsigned n);
 void Problem_destroy(struct Problem * p);
 CSError Problem_enqueue_related_constraints(struct Problem * p, struct Var * v);
+CSError Problem_notify(struct Problem * p, struct Var * v, unsigned events, struct Constraint * cause);
 CSError Problem_create_registry(struct Problem * p);
 CSError Problem_solve_queue(struct Problem * p);
 CSError Problem_solve(struct Problem * p);
+// Depth-first search with propagation at every node. Stops once limit
+// solutions are found, and reports how many were (at most limit).
+// Solutions are told apart by vars[0..n_vars), a block from Problem_create_vars():
+// only those are branched on, the others are left to propagation.
+// Decisions are undone through the trail if it is enabled, otherwise
+// through the Restriction DAG; either way p is left as Problem_solve() would.
+CSError Problem_count_solutions(struct Problem * p, struct Var * vars, unsigned n_vars,
+                                unsigned limit, unsigned * n_solutions);
 CSError Problem_constraint_deactivate(struct Problem * p, struct Constraint * c);
 CSError Problem_constraint_activate(struct Problem * p, struct Constraint * c);
 CSError Problem_var_reset_domain(struct Problem * p, struct Var * v, bitset domain);
 CSError Problem_add_DAG_node(struct Problem * p, struct Restriction * r);
+void Problem_get_memory_usage(struct Problem * p, size_t * bytes, size_t * objects);
+
+// Trail mode. Provenance is not tracked, so deactivating a constraint
+// or widening a domain does not retract what was derived from it:
+// take a checkpoint before, and backtrack after.
+// Disabling the trail backtracks to the state it was enabled in.
+CSError Problem_set_trail_mode(struct Problem * p, unsigned enabled);
+unsigned Problem_push_checkpoint(struct Problem * p);
+void Problem_backtrack_to(struct Problem * p, unsigned checkpoint);
+
+// Snapshots. Problem_snapshot() writes the whole problem into one malloc'd,
+// relocatable buffer: vars, constraints, current domains, active flags,
+// the Restriction DAG, the queues and the trail.
+// Problem_restore() puts a problem back in a state it was snapshotted in;
+// the snapshot must come from p itself or from a clone of it (FAIL_PARAM otherwise).
+// If it runs out of memory halfway, p has no usable state left but can be restored again.
+// Problem_create_from_snapshot() builds a new problem from a snapshot, with all
+// its vars in one block in id order; look them up with P_var() and P_constraint().
+// The buffer is not kept by any of these.
+CSError Problem_snapshot(struct Problem * p, void ** buffer, size_t * size);
+CSError Problem_restore(struct Problem * p, const void * buffer);
+struct Problem * Problem_create_from_snapshot(const void * buffer);
+struct Problem * Problem_clone(struct Problem * p);
+
+// Solver counters. Problem_get_stats() returns FAILURE, and zeroes, if they are compiled out.
+// They are not part of a snapshot: a clone starts from zero, and a restore keeps them.
+CSError Problem_get_stats(struct Problem * p, struct ProblemStats * stats);
+static inline void ProblemStats_add(struct ProblemStats * s, const struct ProblemStats * t)
+{
+        for (unsigned k = 0; k < C_N_KINDS; k++) {
+                s->filter_calls[k] += t->filter_calls[k];
+        }
+        s->filter_quiet           += t->filter_quiet;
+        s->restrictions_created   += t->restrictions_created;
+        s->restrictions_redundant += t->restrictions_redundant;
+        s->restrictions_retracted += t->restrictions_retracted;
+        s->peak_DAG_nodes          = s->peak_DAG_nodes > t->peak_DAG_nodes ? s->peak_DAG_nodes : t->peak_DAG_nodes;
+        s->queue_inserts          += t->queue_inserts;
+        s->queue_duplicates       += t->queue_duplicates;
+        s->infeasible             += t->infeasible;
+}
+#if CS_STATS
+#        define P_STATS(p,update) ((void)((p)->stats.update))
+#        define P_STATS_PEAK(p) ((p)->stats.peak_DAG_nodes < (p)->n_DAG_nodes ? \
+                                 (void)((p)->stats.peak_DAG_nodes = (p)->n_DAG_nodes) : (void)0)
+#else
+#        define P_STATS(p,update) ((void)0)
+#        define P_STATS_PEAK(p) ((void)0)
+#endif
+
+// Tracing, see Trace.h. Problem_trace_start() records into a ring of capacity
+// events, written out to out (left open) whenever it fills, and on
+// Problem_trace_stop() or Problem_destroy(). Both return FAILURE if tracing is compiled out.
+CSError Problem_trace_start(struct Problem * p, FILE * out, uint32_t tag, unsigned capacity);
+CSError Problem_trace_stop(struct Problem * p);
+#if CS_TRACE
+#        define P_TRACE(p,type,id,value,cause,kind) \
+                ((p)->trace ? Trace_record((p)->trace, (type), (id), (value), (cause), (kind)) : (void)0)
+#else
+#        define P_TRACE(p,type,id,value,cause,kind) ((void)0)
+#endif
+
+// The propagation queue. Ids are popped from the cheapest non-empty class.
+static inline void Problem_enqueue(struct Problem * p, unsigned c_id)
+{
+        struct Worklist * q = &p->Q[p->c_registry[c_id].cost_class];
+        P_STATS(p, queue_inserts++);
+        if (CS_STATS && Worklist_contains(q, c_id)) {
+                P_STATS(p, queue_duplicates++);
+        }
+        Worklist_insert(q, c_id);
+}
+static inline int Problem_queue_is_empty(struct Problem * p)
+{
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                if (p->Q[k].n_entries != 0) {
+                        return 0;
+                }
+        }
+        return 1;
+}
+static inline unsigned Problem_queue_length(struct Problem * p)
+{
+        unsigned n = 0;
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                n += p->Q[k].n_entries;
+        }
+        return n;
+}
+static inline CSError Problem_dequeue(struct Problem * p, unsigned * c_id)
+{
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                if (NO_FAILURE == Worklist_pop(&p->Q[k], c_id)) {
+                        return NO_FAILURE;
+                }
+        }
+        return FAILURE;
+}
+// The id Problem_dequeue() would return next
+static inline CSError Problem_queue_peek(struct Problem * p, unsigned * c_id)
+{
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                if (NO_FAILURE == Worklist_peek(&p->Q[k], c_id)) {
+                        return NO_FAILURE;
+                }
+        }
+        return FAILURE;
+}
+static inline void Problem_queue_clear(struct Problem * p)
+{
+        for (unsigned k = 0; k < N_COST_CLASSES; k++) {
+                Worklist_clear(&p->Q[k]);
+        }
+}
 
 #define P_var_register(p,v) (&(p)->var_registry[(v)->id])
+#define P_var(p,id) ((p)->var_registry[(id)].var)
+#define P_constraint(p,id) ((p)->c_registry[(id)].constraint)
 #define P_cons_register(p,c) ((c) ? &(p)->c_registry[(c)->id] : NULL)
-#define P_recent_restriction(p,v) (P_var_register((p),(v))->most_recent_restriction)
+#define P_domain(p,v) ((p)->store.domains[(v)->id])
+#define P_set_domain(p,v,d) DomainStore_set(&(p)->store, (v)->id, (d))
+#define P_recent_restriction(p,v) ((p)->recent_restriction[(v)->id])
+#define P_instances(p,c) ((p)->instances[(c)->id])
 #define P_cons_is_active(p,c) (P_cons_register((p), (c))->active == 1)
+#define P_trail_mode(p) ((p)->trail.enabled)
 
 #endif
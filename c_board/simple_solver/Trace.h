@@ -0,0 +1,86 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+////////
+// Propagation trace
+////////
+// A record of the propagation work a Problem does, for offline profiling.
+// Compiled in with -DCS_TRACE=1 (cmake -DOHNO_TRACE=ON), and then only
+// recorded while Problem_trace_start() is in effect.
+// Events go into a ring allocated up front; each time it fills, and when the
+// trace stops, its events are written out as one block:
+//   struct TraceBlock, then n_events struct TraceEvent
+// in the byte order of the machine that wrote them. Problems may share a
+// file, even from several threads: blocks are written whole, and the tag
+// tells whose they are. Decode with c_board/cli/ohno_trace.c.
+
+#ifndef CS_TRACE
+#        define CS_TRACE 0
+#endif
+
+#define TRACE_MAGIC 0x31435254u /**< "TRC1" */
+
+enum TraceType {
+        TRACE_DRAIN_BEGIN = 1, /**< Problem_solve_queue() starts. value: constraints queued. */
+        TRACE_DRAIN_END,       /**< It returns. value: 1 if infeasible. */
+        TRACE_FILTER,          /**< id: constraint, kind: its kind, value: 1 if it was quiet. */
+        TRACE_NARROW,          /**< id: var, value: its new domain, cause: the constraint. */
+        TRACE_RETRACT          /**< id: var, value: the domain it went back to. */
+};
+
+struct TraceEvent {
+        uint64_t time;  /**< Nanoseconds since the trace started. */
+        uint32_t id;
+        uint32_t value;
+        uint32_t cause;
+        uint8_t  type;  /**< enum TraceType */
+        uint8_t  kind;  /**< enum ConstraintKind */
+        uint16_t reserved;
+};
+
+struct TraceBlock {
+        uint32_t magic;
+        uint32_t tag;         /**< Given to Problem_trace_start(). */
+        uint32_t n_events;
+        uint32_t event_size;  /**< sizeof(struct TraceEvent) */
+};
+
+struct Trace {
+        FILE             * out;
+        uint32_t           tag;
+        uint64_t           start;    /**< Clock at Problem_trace_start(), in nanoseconds. */
+        unsigned           capacity;
+        unsigned           n_events;
+        struct TraceEvent  events[];
+};
+
+// Writes out the ring and empties it
+void Trace_flush(struct Trace * t);
+
+static inline uint64_t Trace_clock(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline void Trace_record(struct Trace * t, unsigned type, unsigned id, unsigned value,
+                                unsigned cause, unsigned kind)
+{
+        if (t->n_events == t->capacity) {
+                Trace_flush(t);
+        }
+        t->events[t->n_events++] = (struct TraceEvent){
+                .time     = Trace_clock() - t->start,
+                .id       = id,
+                .value    = value,
+                .cause    = cause,
+                .type     = type,
+                .kind     = kind,
+                .reserved = 0};
+}
+
+#endif // TRACE_H
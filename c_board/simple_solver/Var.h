@@ -8,6 +8,7 @@
 ////////
 typedef uint_fast32_t bitset;
 #define DOMAIN_SIZE 31
+#define DOMAIN_MASK (((bitset)1 << DOMAIN_SIZE) - 1)
 
 #define REDBIT (1)
 #define BLUEBIT (0)
@@ -16,6 +17,52 @@ typedef uint_fast32_t bitset;
 #define HAS_RED(x) ((x) & 1<<REDBIT)
 #define HAS_BLUE(x) ((x) & 1<<BLUEBIT)
 
+// Index of the lowest set bit. bits must not be 0.
+static inline unsigned bitset_ctz(bitset bits)
+{
+        return __builtin_ctzll((unsigned long long)bits);
+}
+
+// Lowest set bit of bits, or 0
+static inline bitset bitset_lowest(bitset bits)
+{
+        return bits & -bits;
+}
+
+// Highest set bit of bits, or 0
+static inline bitset bitset_highest(bitset bits)
+{
+        return bits ? (bitset)1 << (63 - __builtin_clzll((unsigned long long)bits)) : 0;
+}
+
+// What a change of domain did, as seen by the constraints watching it.
+// Constraints subscribe to a set of these per variable.
+enum DomainEvent {
+        EV_DOMAIN = 1<<0, /**< Lost some value. */
+        EV_BOUNDS = 1<<1, /**< Lost its lowest or highest value. */
+        EV_FIXED  = 1<<2, /**< Has a single value left. */
+        EV_ALL    = EV_DOMAIN | EV_BOUNDS | EV_FIXED
+};
+
+// The events of a change from old to new. Widening raises them all.
+static inline unsigned bitset_events(bitset old, bitset new)
+{
+        if (old == new) {
+                return 0;
+        }
+        if (new & ~old) {
+                return EV_ALL;
+        }
+        unsigned events = EV_DOMAIN;
+        if (bitset_lowest(old) != bitset_lowest(new) || bitset_highest(old) != bitset_highest(new)) {
+                events |= EV_BOUNDS;
+        }
+        if (new && !(new & (new - 1))) {
+                events |= EV_FIXED;
+        }
+        return events;
+}
+
 static inline void bitset_print(bitset bits)
 {
         for (unsigned i = 0; i < DOMAIN_SIZE; i++) {
@@ -36,7 +83,8 @@ static inline void bitset_print(bitset bits)
 struct Var {
         unsigned id;
         unsigned N;
-        bitset domain;
+        bitset domain; /**< Initial domain. Problem_create_registry() copies it into
+                            the Problem's domain array, which is authoritative from then on. */
 };
 
 
@@ -51,4 +99,24 @@ static inline void Var_set(struct Var * v, bitset domain)
         v->domain = domain;
 }
 
+////////
+// Domain store
+////////
+// The current domains of all of a Problem's variables, indexed by var id.
+// Every change is stamped with a tick of a clock, so a filter can tell
+// whether anything it reads has changed since it last ran.
+struct DomainStore {
+        bitset   * domains;
+        uint64_t * stamps;
+        uint64_t   clock;
+};
+
+static inline void DomainStore_set(struct DomainStore * s, unsigned id, bitset domain)
+{
+        if (s->domains[id] != domain) {
+                s->domains[id] = domain;
+                s->stamps[id] = ++s->clock;
+        }
+}
+
 #endif // VAR_H
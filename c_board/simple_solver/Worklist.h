@@ -0,0 +1,121 @@
+#ifndef WORKLIST_H
+#define WORKLIST_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "CSError.h"
+
+////////
+// Worklist
+////////
+// FIFO of dense ids in [0, capacity) where each id is queued at most once.
+// A ring buffer holds the order and a bitmap remembers what is queued,
+// so insert, dedupe and pop are O(1) and never allocate.
+// Inserting an id that is already queued leaves it where it is.
+
+#define WL_WORD_BITS 32
+#define WL_WORD(id) ((id) / WL_WORD_BITS)
+#define WL_BIT(id) ((uint32_t)1 << ((id) % WL_WORD_BITS))
+
+struct Worklist {
+        unsigned   capacity;
+        unsigned   head;      /**< Ring index of the next id to pop. */
+        unsigned   n_entries;
+        unsigned * ring;
+        uint32_t * in_queue;  /**< Bitmap indexed by id. */
+};
+
+static inline CSError Worklist_init(struct Worklist * w, unsigned capacity)
+{
+        unsigned n_words = capacity / WL_WORD_BITS + 1;
+        *w = (struct Worklist){
+                .capacity  = capacity,
+                .head      = 0,
+                .n_entries = 0,
+                .ring      = NULL,
+                .in_queue  = NULL};
+        w->ring = malloc((capacity + 1) * sizeof(unsigned));
+        if (!w->ring) { goto bad_alloc1; }
+        w->in_queue = calloc(n_words, sizeof(uint32_t));
+        if (!w->in_queue) { goto bad_alloc2; }
+        return NO_FAILURE;
+bad_alloc2:
+        free(w->ring);
+        w->ring = NULL;
+bad_alloc1:
+        return FAIL_ALLOC;
+}
+
+static inline void Worklist_destroy(struct Worklist * w)
+{
+        free(w->ring);
+        free(w->in_queue);
+        w->ring = NULL;
+        w->in_queue = NULL;
+        w->n_entries = 0;
+}
+
+static inline int Worklist_contains(struct Worklist * w, unsigned id)
+{
+        return !!(w->in_queue[WL_WORD(id)] & WL_BIT(id));
+}
+
+static inline void Worklist_insert(struct Worklist * w, unsigned id)
+{
+        assert(id < w->capacity);
+        if (Worklist_contains(w, id)) {
+                return;
+        }
+        w->in_queue[WL_WORD(id)] |= WL_BIT(id);
+        unsigned tail = w->head + w->n_entries;
+        if (tail >= w->capacity) {
+                tail -= w->capacity;
+        }
+        w->ring[tail] = id;
+        w->n_entries++;
+}
+
+static inline CSError Worklist_pop(struct Worklist * w, unsigned * id)
+{
+        if (w->n_entries == 0) {
+                goto empty_queue;
+        }
+        unsigned x = w->ring[w->head];
+        if (++w->head == w->capacity) {
+                w->head = 0;
+        }
+        w->n_entries--;
+        w->in_queue[WL_WORD(x)] &= ~WL_BIT(x);
+        if (id) {
+                *id = x;
+        }
+        return NO_FAILURE;
+empty_queue:
+        return FAILURE;
+}
+
+// Like Worklist_pop(), but leaves the id queued
+static inline CSError Worklist_peek(struct Worklist * w, unsigned * id)
+{
+        if (w->n_entries == 0) {
+                goto empty_queue;
+        }
+        *id = w->ring[w->head];
+        return NO_FAILURE;
+empty_queue:
+        return FAILURE;
+}
+
+static inline void Worklist_clear(struct Worklist * w)
+{
+        while (w->n_entries != 0) {
+                Worklist_pop(w, NULL);
+        }
+}
+
+#undef WL_WORD_BITS
+#undef WL_WORD
+#undef WL_BIT
+
+#endif // WORKLIST_H